@@ -8,15 +8,55 @@
 #define __CH_LIB_IFLASH_H__
 
 #include <stdint.h>
+#include <stdbool.h>
+
+/* flash geometry, times are typical values from the datasheet */
+typedef struct
+{
+    uint32_t erase_unit;        /* bytes erased by FLASH_EraseSector */
+    uint32_t program_unit;      /* smallest length FLASH_WriteSector programs */
+    uint32_t erase_time_us;
+    uint32_t program_time_us;   /* per program unit */
+    uint32_t block_size;        /* bytes erased by FLASH_EraseBlock, 0: no block erase */
+}FLASH_Geometry_t;
+
+/* program flash swap control codes and states, see FLASH_SwapControl */
+#define kFLASH_SwapInit             (0x01)
+#define kFLASH_SwapUpdate           (0x02)
+#define kFLASH_SwapComplete         (0x04)
+#define kFLASH_SwapReport           (0x08)
+
+#define kFLASH_SwapModeUninit       (0x00)
+#define kFLASH_SwapModeReady        (0x01)
+#define kFLASH_SwapModeUpdate       (0x02)
+#define kFLASH_SwapModeUpdateErased (0x03)
+#define kFLASH_SwapModeComplete     (0x04)
+
+typedef struct
+{
+    uint8_t mode;               /* kFLASH_SwapModeXXX */
+    uint8_t current_block;      /* 0: block 0 is at address 0, 1: block 1 is */
+    uint8_t next_block;         /* same after the next reset */
+}FLASH_SwapStatus_t;
+
+/* called in the flash command wait loop, see FLASH_SetWaitHook */
+typedef void (*FLASH_WaitHook_t)(void);
 
 
 //!< API 
 void FLASH_Init(void);
 uint32_t FLASH_GetSectorSize(void);
+void FLASH_GetGeometry(FLASH_Geometry_t *geo);
 uint8_t FLASH_WriteSector(uint32_t addr, const uint8_t *buf, uint32_t len);
+uint8_t FLASH_WriteSection(uint32_t addr, const uint8_t *buf, uint32_t len);
 uint8_t FLASH_EraseSector(uint32_t addr);
+uint8_t FLASH_EraseBlock(uint32_t addr);
+void FLASH_SetWaitHook(FLASH_WaitHook_t hook);
+uint32_t FLASH_GetBlockSize(void);
+bool FLASH_IsConcurrentSafe(uint32_t addr);
 uint32_t FLASH_Test(uint32_t startAddr, uint32_t len);
 uint32_t FLASH_GetProgramCmd(void);
+uint8_t FLASH_SwapControl(uint32_t indicator, uint8_t code, FLASH_SwapStatus_t *stat);
 
 #endif
 
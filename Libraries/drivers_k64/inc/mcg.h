@@ -0,0 +1,43 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#ifndef __CH_LIB_MCG_H__
+#define __CH_LIB_MCG_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* OSC0 input, FRDM-K64 feeds EXTAL0 with the 50MHz clock of the Ethernet PHY, a multiple of 2.5MHz */
+#ifndef MCG_EXTAL_CLOCK
+#define MCG_EXTAL_CLOCK         (50*1000*1000)
+#endif
+
+/* core clock of the profile: PLL 120MHz, bus 60MHz, flexbus 40MHz, flash 24MHz */
+#define MCG_PROFILE_CLOCK       (120*1000*1000)
+
+/* clock state before ClockProfileEnter */
+typedef struct
+{
+    uint8_t  c1;
+    uint8_t  c2;
+    uint8_t  c5;
+    uint8_t  c6;
+    uint32_t clkdiv1;
+    uint32_t core_clock;
+}ClockProfile_t;
+
+uint32_t ClockProfileEnter(ClockProfile_t *saved);
+void ClockProfileExit(const ClockProfile_t *saved);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
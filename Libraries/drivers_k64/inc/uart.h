@@ -44,6 +44,10 @@
 #define UART5_RX_PE08_TX_PE09   (0X90E5U)
 #define UART0_RX_PB02_TX_PB01   (0x00008288U)
 
+/* UART_EnableFlowControl */
+#define UART0_RTS_PB02_CTS_PB03 (0x84C8U)
+#define UART0_RTS_PD04_CTS_PD05 (0x88D8U)
+
 /* UART  */
 typedef enum
 {
@@ -59,16 +63,33 @@ typedef enum
     kUART_DMARx,
 }UART_DMA_t;
 
+/* receive loss counters, see UART_GetRxStat */
+typedef struct
+{
+    uint32_t hw_overrun;        /* receiver overrun, the FIFO was not drained in time */
+    uint32_t ring_overrun;      /* bytes dropped because the receive ring was full */
+}UART_RxStat_t;
+
 /* API */
 uint32_t UART_Init(uint32_t MAP, uint32_t baudrate);
 uint32_t UART_DeInit(uint32_t MAP);
 void UART_SetBaudRate(uint32_t instance, uint32_t baud);
 uint32_t UART_GetChar(uint32_t instance, uint8_t *ch);
 void UART_PutChar(uint32_t instance, uint8_t ch);
+void UART_WaitTxComplete(uint32_t instance);
 uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val);
 uint32_t UART_SetDMAMode(uint32_t instance, UART_DMA_t mode, bool val);
 void UART_EnableTxFIFO(uint32_t instance, bool val);
 void UART_EnableRxFIFO(uint32_t instance, bool val);
+void UART_SetRxWatermark(uint32_t instance, uint8_t wm);
+uint32_t UART_GetFIFODepth(uint32_t instance, bool tx);
+uint32_t UART_Write(uint32_t instance, const uint8_t *buf, uint32_t len);
+uint32_t UART_Read(uint32_t instance, uint8_t *buf, uint32_t max);
+uint32_t UART_EnableRxRing(uint32_t instance, uint8_t *buf, uint32_t size);
+void UART_RxPoll(uint32_t instance);
+void UART_GetRxStat(uint32_t instance, UART_RxStat_t *stat);
+void UART_IRQHandler(uint32_t instance);
+uint32_t UART_EnableFlowControl(uint32_t MAP, uint32_t level);
 
 #ifdef __cplusplus
 }
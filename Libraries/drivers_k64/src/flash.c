@@ -22,6 +22,7 @@
 #define PGMONCE   0x43  /* program once */
 #define ERSALL    0x44  /* erase all blocks */
 #define VFYKEY    0x45  /* verift backdoor key */
+#define SWAP      0x46  /* program flash swap control */
 #define PGMPART   0x80  /* program paritition */
 #define SETRAM    0x81  /* set flexram function */
 #define NORMAL_LEVEL 0x0
@@ -34,6 +35,11 @@
 #define MGSTAT0 (1<<0)
 
 
+/* program flash block size, parts with two blocks can run a command on one block while fetching from the other */
+#ifndef BLOCK_SIZE
+#define BLOCK_SIZE      (512*1024)
+#endif
+
 #if defined(FTFL)
 #define FTF    FTFL
 #define SECTOR_SIZE     (2048)
@@ -56,7 +62,40 @@
 #define FTF    FTFA
 #endif
 
+/* typical tersscr and tpgm4/tpgm8 command execution time */
+#define ERASE_TIME_US       (15000)
+#define PROGRAM_TIME_US     ((PROGRAM_CMD == PGM8)?(90):(65))
+
+#if defined(FTFE)
+/* PGMSEC takes its data from the FlexRAM, address and length in 128 bit units */
+#define SECTION_UNIT        (16)
+#define SECTION_RAM         ((volatile uint32_t*)0x14000000)
+#define SECTION_RAM_SIZE    (4096)
+#endif
+
+
+static FLASH_WaitHook_t s_flash_wait_hook;
+
+#if (CHLIB_RAMFUNC_SUPPORT == 1)
+/* whole launch and wait loop runs from RAM, hook is called while CCIF is clear */
+static RAMFUNC uint8_t FlashCmdStart(void)
+{
+    /* clear command result flags */
+    FTF->FSTAT = ACCERR | FPVIOL;
+    FTF->FSTAT = CCIF;
+    while(!(FTF->FSTAT & CCIF))
+    {
+        if(s_flash_wait_hook)
+        {
+            s_flash_wait_hook();
+        }
+    }
+    
+    if(FTF->FSTAT & (ACCERR | FPVIOL | MGSTAT0)) return CH_ERR;
+    return CH_OK;
+}
 
+#else
 volatile uint8_t s_flash_command_run[] = {0x00, 0xB5, 0x80, 0x21, 0x01, 0x70, 0x01, 0x78, 0x09, 0x06, 0xFC, 0xD5,0x00, 0xBD};
 typedef void (*flash_run_entry_t)(volatile uint8_t *reg);
 flash_run_entry_t s_flash_run_entry;
@@ -71,6 +110,87 @@ static inline uint8_t FlashCmdStart(void)
     if(FTF->FSTAT & (ACCERR | FPVIOL | MGSTAT0)) return CH_ERR;
     return CH_OK;
 }
+#endif /* CHLIB_RAMFUNC_SUPPORT */
+
+ /**
+ * @brief  install a function called in the flash command wait loop
+ * @note   on the same-block path the hook is only called when CHLIB_RAMFUNC_SUPPORT == 1, it must then
+ *         be a RAMFUNC and must not access flash. On the concurrent path it runs with interrupts enabled
+ * @param  hook: NULL to remove
+ * @retval None
+ */
+void FLASH_SetWaitHook(FLASH_WaitHook_t hook)
+{
+    s_flash_wait_hook = hook;
+}
+
+ /**
+ * @brief  get program flash block size
+ * @retval block size in bytes
+ */
+uint32_t FLASH_GetBlockSize(void)
+{
+    return BLOCK_SIZE;
+}
+
+ /**
+ * @brief  check if a flash command on addr can run while the CPU keeps fetching from flash
+ * @note   true when addr sits in another program flash block than both the running code and the vector table
+ * @param  addr: target address of the flash command
+ * @retval true or false
+ */
+bool FLASH_IsConcurrentSafe(uint32_t addr)
+{
+    uint32_t blk = addr / BLOCK_SIZE;
+    
+    /* data flash */
+    if(addr >= 0x10000000)
+    {
+        return false;
+    }
+    
+#if defined(SIM_FCFG2_PFLSH_MASK)
+    /* second block is FlexNVM, not program flash */
+    if(!(SIM->FCFG2 & SIM_FCFG2_PFLSH_MASK))
+    {
+        return false;
+    }
+#endif
+    
+    if(blk == ((uint32_t)FLASH_IsConcurrentSafe / BLOCK_SIZE) || blk == (SCB->VTOR / BLOCK_SIZE))
+    {
+        return false;
+    }
+    return true;
+}
+
+/* launch the command loaded into FCCOB, addr is the target used to pick the safe path */
+static uint8_t FlashCmdRun(uint32_t addr)
+{
+    uint8_t ret;
+    
+    if(FLASH_IsConcurrentSafe(addr))
+    {
+        /* code is fetched from the other block: keep interrupts enabled */
+        FTF->FSTAT = ACCERR | FPVIOL;
+        FTF->FSTAT = CCIF;
+        while(!(FTF->FSTAT & CCIF))
+        {
+            if(s_flash_wait_hook)
+            {
+                s_flash_wait_hook();
+            }
+        }
+        ret = (FTF->FSTAT & (ACCERR | FPVIOL | MGSTAT0))?(CH_ERR):(CH_OK);
+    }
+    else
+    {
+        __disable_irq();
+        ret = FlashCmdStart();
+        __enable_irq();
+    }
+    return ret;
+}
 
  /**
  * @brief  
@@ -83,6 +203,20 @@ uint32_t FLASH_GetSectorSize(void)
     return SECTOR_SIZE;
 }
 
+ /**
+ * @brief  get erase/program unit and typical command time
+ * @param  geo: filled by this function
+ * @retval None
+ */
+void FLASH_GetGeometry(FLASH_Geometry_t *geo)
+{
+    geo->erase_unit = SECTOR_SIZE;
+    geo->program_unit = (PROGRAM_CMD == PGM8)?(8):(4);
+    geo->erase_time_us = ERASE_TIME_US;
+    geo->program_time_us = PROGRAM_TIME_US;
+    geo->block_size = BLOCK_SIZE;
+}
+
  /**
  * @brief  
  * @note   None
@@ -136,13 +270,33 @@ uint8_t FLASH_EraseSector(uint32_t addr)
 	FTF->FCCOB1 = dest.byte[2];
 	FTF->FCCOB2 = dest.byte[1];
 	FTF->FCCOB3 = dest.byte[0];
-    __disable_irq();
-    ret = FlashCmdStart();
-    __enable_irq();
+    ret = FlashCmdRun(addr);
     
     return ret;
 }
 
+ /**
+ * @brief  erase a whole program flash block with one ERSBLK command
+ * @note   fails if any sector of the block is protected
+ * @param  addr: any address in the block
+ * @retval CH_OK or CH_ERR
+ */
+uint8_t FLASH_EraseBlock(uint32_t addr)
+{
+	union
+	{
+		uint32_t  word;
+		uint8_t   byte[4];
+	} dest;
+	dest.word = ALIGN_DOWN(addr, BLOCK_SIZE);
+
+	FTF->FCCOB0 = ERSBLK;
+	FTF->FCCOB1 = dest.byte[2];
+	FTF->FCCOB2 = dest.byte[1];
+	FTF->FCCOB3 = dest.byte[0];
+    return FlashCmdRun(dest.word);
+}
+
  /**
  * @brief  Flash
  * @note   
@@ -204,11 +358,8 @@ uint8_t FLASH_WriteSector(uint32_t addr, const uint8_t *buf, uint32_t len)
             FTF->FCCOBB = buf[4];
         }
 
+        ret = FlashCmdRun(dest.word);
 		dest.word += step; buf += step;
-
-        __disable_irq();
-        ret = FlashCmdStart();
-        __enable_irq();
         
 		if(CH_OK != ret) 
         {
@@ -218,6 +369,76 @@ uint8_t FLASH_WriteSector(uint32_t addr, const uint8_t *buf, uint32_t len)
     return CH_OK;
 }
 
+ /**
+ * @brief  program a run of flash with as few commands as possible
+ * @note   on FTFE parts whole 128 bit units go through PGMSEC, up to one sector per command, when the
+ *         FlexRAM is available as RAM. The rest, and every other part, is programmed with FLASH_WriteSector
+ * @param  addr: start address, aligned to the program unit
+ * @param  buf : data
+ * @param  len : n * program unit
+ * @retval CH_OK or CH_ERR
+ */
+uint8_t FLASH_WriteSection(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+#if defined(FTFE)
+    uint32_t n, i;
+    union
+    {
+        uint32_t  word;
+        uint8_t   byte[4];
+    } dest;
+    
+    /* FlexRAM used as EEPROM, or data flash */
+    if(!(FTF->FCNFG & FTFE_FCNFG_RAMRDY_MASK) || (addr >= 0x10000000))
+    {
+        return FLASH_WriteSector(addr, buf, len);
+    }
+    
+    while(len)
+    {
+        if((addr & (SECTION_UNIT - 1)) || (len < SECTION_UNIT))
+        {
+            /* up to the next 128 bit boundary, or the tail */
+            n = SECTION_UNIT - (addr & (SECTION_UNIT - 1));
+            n = (len < n)?(len):(n);
+            if(FLASH_WriteSector(addr, buf, n))
+            {
+                return CH_ERR;
+            }
+        }
+        else
+        {
+            /* one command stays inside a sector and the FlexRAM */
+            n = SECTOR_SIZE - (addr & (SECTOR_SIZE - 1));
+            n = (len < n)?(len & ~(SECTION_UNIT - 1)):(n);
+            n = (n > SECTION_RAM_SIZE)?(SECTION_RAM_SIZE):(n);
+            for(i=0; i<n; i+=4)
+            {
+                SECTION_RAM[i/4] = buf[i] | (buf[i+1] << 8) | (buf[i+2] << 16) | ((uint32_t)buf[i+3] << 24);
+            }
+            
+            dest.word = addr;
+            FTF->FCCOB0 = PGMSEC;
+            FTF->FCCOB1 = dest.byte[2];
+            FTF->FCCOB2 = dest.byte[1];
+            FTF->FCCOB3 = dest.byte[0];
+            FTF->FCCOB4 = ((n / SECTION_UNIT) >> 8) & 0xFF;
+            FTF->FCCOB5 = (n / SECTION_UNIT) & 0xFF;
+            if(FlashCmdRun(addr))
+            {
+                return CH_ERR;
+            }
+        }
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+    return CH_OK;
+#else
+    return FLASH_WriteSector(addr, buf, len);
+#endif
+}
+
  /**
  * @brief  
  * @note   None
@@ -323,3 +544,44 @@ uint32_t FLASH_Test(uint32_t addr, uint32_t len)
     }
     return ret;
 }
+
+ /**
+ * @brief  run one program flash swap control command
+ * @note   the two program flash blocks exchange addresses at the next reset once the swap system is
+ *         in complete state. Only parts with two program flash blocks (FTFE, no FlexNVM) support it
+ * @param  indicator: swap indicator address in the lower block, 16 byte aligned and outside the flash
+ *         config field. The sector holding it, and its twin in the upper block, are reserved for the swap system
+ * @param  code: kFLASH_SwapInit, kFLASH_SwapUpdate, kFLASH_SwapComplete or kFLASH_SwapReport
+ * @param  stat: swap state after the command, may be NULL
+ * @retval CH_OK or CH_ERR
+ */
+uint8_t FLASH_SwapControl(uint32_t indicator, uint8_t code, FLASH_SwapStatus_t *stat)
+{
+    uint8_t ret;
+	union
+	{
+		uint32_t  word;
+		uint8_t   byte[4];
+	} dest;
+	dest.word = indicator;
+
+	FTF->FCCOB0 = SWAP;
+	FTF->FCCOB1 = dest.byte[2];
+	FTF->FCCOB2 = dest.byte[1];
+	FTF->FCCOB3 = dest.byte[0];
+	FTF->FCCOB4 = code;
+	FTF->FCCOB5 = 0xFF;
+	FTF->FCCOB6 = 0xFF;
+	FTF->FCCOB7 = 0xFF;
+    
+    /* the indicator sector is in the running block */
+    ret = FlashCmdRun(indicator);
+    
+    if(stat)
+    {
+        stat->mode = FTF->FCCOB5;
+        stat->current_block = FTF->FCCOB6;
+        stat->next_block = FTF->FCCOB7;
+    }
+    return ret;
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+#include "common.h"
+#include "mcg.h"
+
+#if defined(MCG)
+
+#define MCG_WAIT_CNT            (200000)
+#define MCG_PLL_REF             (2500000)
+
+static uint32_t wait_status(uint8_t mask, uint8_t val)
+{
+    uint32_t i;
+
+    for(i=0; i<MCG_WAIT_CNT; i++)
+    {
+        if((MCG->S & mask) == val)
+        {
+            return CH_OK;
+        }
+    }
+    return CH_TIMEOUT;
+}
+
+ /**
+ * @brief  switch from FEI to PEE at MCG_PROFILE_CLOCK, from MCG_EXTAL_CLOCK through FBE and PBE
+ * @note   SystemCoreClock follows, peripherals clocked from the core or bus clock must be set up
+ *         again by the caller. A missing external clock or PLL lock leaves the clocks as they were
+ * @param  saved: filled with the clock state to hand to ClockProfileExit
+ * @retval CH_OK, CH_ERR when not in FEI, CH_TIMEOUT
+ */
+uint32_t ClockProfileEnter(ClockProfile_t *saved)
+{
+    saved->c1 = MCG->C1;
+    saved->c2 = MCG->C2;
+    saved->c5 = MCG->C5;
+    saved->c6 = MCG->C6;
+    saved->clkdiv1 = SIM->CLKDIV1;
+    saved->core_clock = SystemCoreClock;
+
+    /* only from the reset mode, the way back is then known */
+    if((MCG->S & (MCG_S_IREFST_MASK | MCG_S_CLKST_MASK)) != MCG_S_IREFST_MASK)
+    {
+        return CH_ERR;
+    }
+
+    /* dividers first, every clock stays in its range on the way up */
+    SIM->CLKDIV1 = SIM_CLKDIV1_OUTDIV1(0) | SIM_CLKDIV1_OUTDIV2(1) | SIM_CLKDIV1_OUTDIV3(2) | SIM_CLKDIV1_OUTDIV4(4);
+
+    /* FBE: external clock without crystal, very high range. FRDIV 1536 keeps the FLL reference near 32kHz */
+    MCG->C2 = (MCG->C2 & ~(MCG_C2_RANGE_MASK | MCG_C2_HGO_MASK | MCG_C2_EREFS_MASK)) | MCG_C2_RANGE(2);
+    MCG->C1 = (MCG->C1 & (MCG_C1_IRCLKEN_MASK | MCG_C1_IREFSTEN_MASK)) | MCG_C1_CLKS(2) | MCG_C1_FRDIV(7);
+    if(wait_status(MCG_S_IREFST_MASK | MCG_S_CLKST_MASK, MCG_S_CLKST(2)))
+    {
+        ClockProfileExit(saved);
+        return CH_TIMEOUT;
+    }
+
+    /* PBE: PLL from a 2.5MHz reference */
+    MCG->C5 = MCG_C5_PRDIV0(MCG_EXTAL_CLOCK / MCG_PLL_REF - 1);
+    MCG->C6 = (MCG->C6 & ~MCG_C6_VDIV0_MASK) | MCG_C6_PLLS_MASK | MCG_C6_VDIV0(MCG_PROFILE_CLOCK / MCG_PLL_REF - 24);
+    if(wait_status(MCG_S_PLLST_MASK | MCG_S_LOCK0_MASK, MCG_S_PLLST_MASK | MCG_S_LOCK0_MASK))
+    {
+        ClockProfileExit(saved);
+        return CH_TIMEOUT;
+    }
+
+    /* PEE */
+    MCG->C1 &= ~MCG_C1_CLKS_MASK;
+    if(wait_status(MCG_S_CLKST_MASK, MCG_S_CLKST(3)))
+    {
+        ClockProfileExit(saved);
+        return CH_TIMEOUT;
+    }
+
+    SystemCoreClock = MCG_PROFILE_CLOCK;
+    return CH_OK;
+}
+
+ /**
+ * @brief  go back to the FEI state ClockProfileEnter started from, through PBE and FBE
+ * @param  saved: clock state from ClockProfileEnter
+ * @retval None
+ */
+void ClockProfileExit(const ClockProfile_t *saved)
+{
+    if((MCG->S & MCG_S_CLKST_MASK) == MCG_S_CLKST(3))
+    {
+        MCG->C1 = (MCG->C1 & ~MCG_C1_CLKS_MASK) | MCG_C1_CLKS(2);
+        wait_status(MCG_S_CLKST_MASK, MCG_S_CLKST(2));
+    }
+
+    MCG->C6 = saved->c6;
+    wait_status(MCG_S_PLLST_MASK, 0);
+    MCG->C5 = saved->c5;
+
+    /* FLL on the internal reference again */
+    MCG->C1 = saved->c1;
+    wait_status(MCG_S_IREFST_MASK | MCG_S_CLKST_MASK, MCG_S_IREFST_MASK);
+    MCG->C2 = saved->c2;
+
+    SIM->CLKDIV1 = saved->clkdiv1;
+    SystemCoreClock = saved->core_clock;
+}
+
+#endif
+
@@ -55,6 +55,22 @@ static const Reg_t UARTClkGate[] =
 #endif
 
 
+/* single producer (IRQ or UART_RxPoll with IRQ masked), single consumer (UART_Read) ring,
+   kept in RAM with its own base pointer so UART_RxPoll can run while flash is busy */
+typedef struct
+{
+    UART_Type *base;
+    volatile uint8_t *buf;
+    uint32_t mask;
+    volatile uint32_t in;
+    volatile uint32_t out;
+    uint32_t rts_level;             /* 0: no flow control, else fill level where draining stops */
+    volatile uint32_t paused;       /* RX interrupt off, the FIFO fills and RTS is deasserted */
+    UART_RxStat_t stat;
+}UART_Ring_t;
+
+static UART_Ring_t UART_RxRing[ARRAY_SIZE(UARTBases)];
+
 #if (defined(MK64F12) || defined(MK70F15) || defined(MK60D10) || defined(MK22F12) || defined(MKS22F25612) || defined(MK26F18) || defined(MK20D5) || defined(MK02F12810))
 static const IRQn_Type UART_IRQTbl[] =
 {
@@ -345,23 +361,97 @@ uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val)
     return CH_OK;
 }
 
+/* FIFO size field of PFIFO to entries: 0 is a single data buffer, then 4, 8, 16 ... */
+static uint32_t _FIFODepth(uint32_t size)
+{
+    return (size == 0)?(1):(1 << (size + 1));
+}
+
+/**
+ * @brief  enable or disable the transmit FIFO
+ * @note   the transmitter is stopped while PFIFO is changed and the FIFO is flushed
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  val : true to enable
+ * @retval None
+ */
 void UART_EnableTxFIFO(uint32_t instance, bool val)
 {
 #if defined(UART_PFIFO_TXFE_MASK)
     UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    uint8_t c2 = UARTx->C2;
+    
+    UARTx->C2 &= ~(UART_C2_TE_MASK | UART_C2_RE_MASK);
     (val)?
     (UARTx->PFIFO |= UART_PFIFO_TXFE_MASK):
     (UARTx->PFIFO &= ~UART_PFIFO_TXFE_MASK);
+    UARTx->CFIFO |= UART_CFIFO_TXFLUSH_MASK;
+    UARTx->C2 = c2;
 #endif
 }
 
+/**
+ * @brief  enable or disable the receive FIFO
+ * @note   the receiver is stopped while PFIFO is changed and the FIFO is flushed
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  val : true to enable
+ * @retval None
+ */
 void UART_EnableRxFIFO(uint32_t instance, bool val)
 {
 #if defined(UART_PFIFO_RXFE_MASK)
     UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    uint8_t c2 = UARTx->C2;
+    
+    UARTx->C2 &= ~(UART_C2_TE_MASK | UART_C2_RE_MASK);
     (val)?
     (UARTx->PFIFO |= UART_PFIFO_RXFE_MASK):
     (UARTx->PFIFO &= ~UART_PFIFO_RXFE_MASK);
+    UARTx->CFIFO |= UART_CFIFO_RXFLUSH_MASK;
+    UARTx->C2 = c2;
+#endif
+}
+
+/**
+ * @brief  set the receive watermark
+ * @note   RDRF, and the RX interrupt, are asserted when the receive FIFO holds at least wm
+ *         bytes; UART_EnableRxRing also enables the idle line interrupt for the tail below wm
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  wm : 1 to the receive FIFO depth
+ * @retval None
+ */
+void UART_SetRxWatermark(uint32_t instance, uint8_t wm)
+{
+    UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    uint32_t depth = UART_GetFIFODepth(instance, false);
+    
+    if(wm == 0) wm = 1;
+    if(wm > depth) wm = depth;
+    UARTx->RWFIFO = wm;
+}
+
+/**
+ * @brief  get the FIFO depth
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  tx : true for the transmit FIFO
+ * @retval entries, 1 if the FIFO is disabled or not present
+ */
+uint32_t UART_GetFIFODepth(uint32_t instance, bool tx)
+{
+#if defined(UART_PFIFO_RXFE_MASK)
+    UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    uint8_t pfifo = UARTx->PFIFO;
+    
+    if(tx)
+    {
+        return (pfifo & UART_PFIFO_TXFE_MASK)?(_FIFODepth((pfifo & UART_PFIFO_TXFIFOSIZE_MASK) >> UART_PFIFO_TXFIFOSIZE_SHIFT)):(1);
+    }
+    return (pfifo & UART_PFIFO_RXFE_MASK)?(_FIFODepth((pfifo & UART_PFIFO_RXFIFOSIZE_MASK) >> UART_PFIFO_RXFIFOSIZE_SHIFT)):(1);
+#else
+    return 1;
 #endif
 }
 
@@ -380,6 +470,20 @@ void UART_PutChar(uint32_t instance, uint8_t ch)
     UARTx->D = (uint8_t)ch;
 }
 
+/**
+ * @brief  wait until the last byte has left the shifter
+ * @note   TC: the transmit buffer and FIFO is empty and the line is idle. Call it after the last byte was
+ *         handed to the UART
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @retval None
+ */
+void UART_WaitTxComplete(uint32_t instance)
+{
+    UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    while(!(UARTx->S1 & UART_S1_TC_MASK));
+}
+
 /**
  * @brief  
  * @note   None
@@ -391,6 +495,13 @@ void UART_PutChar(uint32_t instance, uint8_t ch)
 uint32_t UART_GetChar(uint32_t instance, uint8_t *ch)
 {
     UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    
+    /* receive ring owns the receiver */
+    if(UART_RxRing[instance].buf)
+    {
+        return (UART_Read(instance, ch, 1) == 1)?(CH_OK):(CH_ERR);
+    }
+    
     if(UARTx->S1 & UART_S1_RDRF_MASK)
     {
         *ch = (uint8_t)(UARTx->D);	
@@ -405,6 +516,225 @@ uint32_t UART_GetChar(uint32_t instance, uint8_t *ch)
 }
 
 
+/**
+ * @brief  write as many bytes as the transmit FIFO has room for, does not wait
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  buf : data
+ * @param  len : length in bytes
+ * @retval number of bytes written
+ */
+uint32_t UART_Write(uint32_t instance, const uint8_t *buf, uint32_t len)
+{
+    UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    uint32_t room, n = 0;
+    
+    if(UARTx->PFIFO & UART_PFIFO_TXFE_MASK)
+    {
+        room = UART_GetFIFODepth(instance, true) - UARTx->TCFIFO;
+    }
+    else
+    {
+        room = (UARTx->S1 & UART_S1_TDRE_MASK)?(1):(0);
+    }
+    
+    while((n < room) && (n < len))
+    {
+        UARTx->D = buf[n++];
+    }
+    return n;
+}
+
+/**
+ * @brief  receive into a ring buffer from the RX interrupt
+ * @note   with the receive FIFO enabled the interrupt comes at the watermark and on
+ *         idle line, each one drains the FIFO in one pass; UART_GetChar and UART_Read
+ *         then read from the ring
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  buf: ring storage, must stay valid
+ * @param  size: power of 2
+ * @retval CH_OK or CH_ERR
+ */
+uint32_t UART_EnableRxRing(uint32_t instance, uint8_t *buf, uint32_t size)
+{
+    UART_Ring_t *r = &UART_RxRing[instance];
+    
+    if((size == 0) || (size & (size - 1)))
+    {
+        return CH_ERR;
+    }
+    
+    r->base = (UART_Type*)UARTBases[instance];
+    r->mask = size - 1;
+    r->in = 0;
+    r->out = 0;
+    r->paused = 0;
+    r->buf = buf;
+    
+    UART_SetIntMode(instance, kUART_IntRx, true);
+    UART_SetIntMode(instance, kUART_IntIdleLine, true);
+    return CH_OK;
+}
+
+/**
+ * @brief  move all bytes of the receive FIFO into the ring
+ * @note   called by the IRQ handler, may also be called with interrupts masked
+ *         (e.g. from a flash wait hook), it is a RAMFUNC and only touches RAM and the UART
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @retval None
+ */
+RAMFUNC void UART_RxPoll(uint32_t instance)
+{
+    UART_Ring_t *r = &UART_RxRing[instance];
+    UART_Type *UARTx = r->base;
+    uint32_t in = r->in;
+    uint32_t cnt, n;
+    uint8_t s1, ch;
+    
+    if(!r->buf || r->paused)
+    {
+        return;
+    }
+    
+    /* ring above the flow control level: leave the data in the FIFO, the receiver
+       deasserts RTS at the watermark and the sender stops */
+    if(r->rts_level && ((in - r->out) >= r->rts_level))
+    {
+        r->paused = 1;
+        UARTx->C2 &= ~(UART_C2_RIE_MASK | UART_C2_ILIE_MASK);
+        return;
+    }
+    
+    /* S1 then D clears RDRF, IDLE and OR */
+    s1 = UARTx->S1;
+    cnt = (UARTx->PFIFO & UART_PFIFO_RXFE_MASK)?(UARTx->RCFIFO):((s1 & UART_S1_RDRF_MASK)?(1):(0));
+    for(n = 0; n < cnt; n++)
+    {
+        ch = UARTx->D;
+        if((in - r->out) > r->mask)
+        {
+            r->stat.ring_overrun++;
+            continue;
+        }
+        r->buf[in & r->mask] = ch;
+        in++;
+    }
+    r->in = in;
+    
+    if(s1 & UART_S1_OR_MASK)
+    {
+        r->stat.hw_overrun++;
+    }
+    
+    /* flag set without data: the dummy read underflows the FIFO, flush it */
+    if((cnt == 0) && (s1 & (UART_S1_IDLE_MASK | UART_S1_OR_MASK)))
+    {
+        (void)UARTx->D;
+        UARTx->CFIFO |= UART_CFIFO_RXFLUSH_MASK;
+        UARTx->SFIFO = UART_SFIFO_RXUF_MASK;
+    }
+}
+
+/**
+ * @brief  read up to max bytes
+ * @note   from the ring when UART_EnableRxRing was called, otherwise straight from
+ *         the receive FIFO, all entries in RCFIFO in one pass
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  buf: destination
+ * @param  max: size of buf
+ * @retval number of bytes read, 0 if none
+ */
+uint32_t UART_Read(uint32_t instance, uint8_t *buf, uint32_t max)
+{
+    UART_Ring_t *r = &UART_RxRing[instance];
+    UART_Type *UARTx = (UART_Type*)UARTBases[instance];
+    uint32_t out = r->out;
+    uint32_t n = 0;
+    uint32_t cnt;
+    
+    if(!r->buf)
+    {
+        if(!(UARTx->PFIFO & UART_PFIFO_RXFE_MASK))
+        {
+            return (max && UART_GetChar(instance, buf) == CH_OK)?(1):(0);
+        }
+        (void)UARTx->S1;
+        cnt = UARTx->RCFIFO;
+        while((n < max) && (n < cnt))
+        {
+            buf[n++] = UARTx->D;
+        }
+        return n;
+    }
+    
+    while((n < max) && (out != r->in))
+    {
+        buf[n++] = r->buf[out & r->mask];
+        out++;
+    }
+    r->out = out;
+    
+    /* room again: the pending RDRF interrupt drains the FIFO and RTS is asserted */
+    if(r->paused && ((r->in - out) < r->rts_level))
+    {
+        r->paused = 0;
+        r->base->C2 |= UART_C2_RIE_MASK | UART_C2_ILIE_MASK;
+    }
+    return n;
+}
+
+/**
+ * @brief  enable RTS/CTS hardware flow control
+ * @note   the transmitter waits for CTS, the receiver deasserts RTS when the receive FIFO
+ *         reaches the watermark; with a receive ring the FIFO is no longer drained while
+ *         the ring holds level bytes or more, so RTS follows the ring fill
+ * @param  MAP : RTS/CTS pins, e.g. UART0_RTS_PB02_CTS_PB03
+ * @param  level : ring fill where RTS is deasserted, 0 for FIFO watermark only
+ * @retval instance
+ */
+uint32_t UART_EnableFlowControl(uint32_t MAP, uint32_t level)
+{
+    map_t * pq = (map_t*)&(MAP);
+    UART_Type *UARTx = (UART_Type*)UARTBases[pq->ip];
+    
+    PIN_SET_MUX;
+    UARTx->MODEM |= UART_MODEM_RXRTSE_MASK | UART_MODEM_TXCTSE_MASK;
+    UART_RxRing[pq->ip].rts_level = level;
+    return pq->ip;
+}
+
+/**
+ * @brief  get receive loss counters
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-5
+ * @param  stat: filled by this function
+ * @retval None
+ */
+void UART_GetRxStat(uint32_t instance, UART_RxStat_t *stat)
+{
+    *stat = UART_RxRing[instance].stat;
+}
+
+void UART_IRQHandler(uint32_t instance)
+{
+    UART_RxPoll(instance);
+}
+
+#if (defined(MK64F12) || defined(MK70F15) || defined(MK60D10) || defined(MK22F12) || defined(MKS22F25612) || defined(MK26F18) || defined(MK20D5) || defined(MK02F12810))
+void UART0_RX_TX_IRQHandler(void)
+{
+    UART_IRQHandler(HW_UART0);
+}
+
+void UART1_RX_TX_IRQHandler(void)
+{
+    UART_IRQHandler(HW_UART1);
+}
+#endif
+
 /*
 static const QuickInit_Type UART_QuickInitTable[] =
 {
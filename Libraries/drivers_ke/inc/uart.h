@@ -33,6 +33,7 @@ uint32_t UART_DeInit(uint32_t MAP);
 void UART_SetBaudRate(uint32_t instance, uint32_t baud);
 uint32_t UART_GetChar(uint32_t instance, uint8_t *ch);
 void UART_PutChar(uint32_t instance, uint8_t ch);
+void UART_WaitTxComplete(uint32_t instance);
 uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val);
 void UART_SetDebugInstance(uint32_t instance);
 uint32_t UART_GetDebugInstance(void);
@@ -9,6 +9,11 @@
 
 
 #define SECTOR_SIZE     (512)
+#define PROGRAM_SIZE    (8)
+
+/* typical sector erase and 2 longword program time */
+#define ERASE_TIME_US       (20000)
+#define PROGRAM_TIME_US     (150)
 
 #define FTMRH_FCLKDIV_FDIVLD_MASK                0x80u
 #define FTMRH_FSTAT_CCIF_MASK                    0x80u
@@ -36,6 +41,20 @@ uint32_t FLASH_GetSectorSize(void)
     return SECTOR_SIZE;
 }
 
+ /**
+ * @brief  get erase/program unit and typical command time
+ * @param  geo: filled by this function
+ * @retval None
+ */
+void FLASH_GetGeometry(FLASH_Geometry_t *geo)
+{
+    geo->erase_unit = SECTOR_SIZE;
+    geo->program_unit = PROGRAM_SIZE;
+    geo->erase_time_us = ERASE_TIME_US;
+    geo->program_time_us = PROGRAM_TIME_US;
+    geo->block_size = 0;    /* single program block, holds the bootloader */
+}
+
 
  /**
  * @brief  Flash
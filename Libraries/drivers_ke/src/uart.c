@@ -164,6 +164,20 @@ void UART_PutChar(uint32_t instance, uint8_t ch)
     UARTx->D = (uint8_t)ch;
 }
 
+/**
+ * @brief  wait until the last byte has left the shifter
+ * @note   TC: the transmit buffer is empty and the line is idle. Call it after the last byte was
+ *         handed to the UART
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-2
+ * @retval None
+ */
+void UART_WaitTxComplete(uint32_t instance)
+{
+    UART_Type * UARTx = (UART_Type*)UARTBases[instance];
+    while(!(UARTx->S1 & UART_S1_TC_MASK));
+}
+
 uint32_t UART_GetChar(uint32_t instance, uint8_t *ch)
 {
     UART_Type * UARTx = (UART_Type*)UARTBases[instance];
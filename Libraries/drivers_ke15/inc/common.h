@@ -101,6 +101,22 @@
 #endif /* Compiler Related Definitions */
 #endif
 
+/* RAM code: the scatter file must place "* (RamFunction)" in a RAM execution region, the project
+   then defines CHLIB_RAMFUNC_REGION. The layout uVision generates keeps the section in flash, only
+   frdm_ke17_bl ships such a scatter file so far */
+#ifndef CHLIB_RAMFUNC_SUPPORT
+#define CHLIB_RAMFUNC_SUPPORT   (0)
+#endif
+
+#if (CHLIB_RAMFUNC_SUPPORT == 1)
+#if !defined(CHLIB_RAMFUNC_REGION)
+#error "CHLIB_RAMFUNC_SUPPORT needs a scatter file with * (RamFunction) in RAM, then define CHLIB_RAMFUNC_REGION"
+#endif
+#define RAMFUNC                 __attribute__((section("RamFunction")))
+#else
+#define RAMFUNC
+#endif
+
 #define MAKE_VERSION(major, minor, bugfix) (((major) << 16) | ((minor) << 8) | (bugfix))
 
 #ifndef MIN
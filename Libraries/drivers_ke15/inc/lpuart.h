@@ -36,6 +36,13 @@ typedef enum
 #define LPUART0_RX_PA04_TX_PA03   (0x00008700U)
 
 
+/* receive loss counters, see LPUART_GetRxStat */
+typedef struct
+{
+    uint32_t hw_overrun;        /* receiver overrun, DATA was not read in time */
+    uint32_t ring_overrun;      /* bytes dropped because the receive ring was full */
+}LPUART_RxStat_t;
+
 /*!< LPUART instance */
 #define HW_LPUART0  (0x00U)
 #define HW_LPUART1  (0x01U)
@@ -44,10 +51,17 @@ typedef enum
 //!< API 
 uint32_t LPUART_Init(uint32_t MAP, uint32_t baudrate);
 void LPUART_PutChar(uint32_t instance, uint8_t ch);
+void LPUART_WaitTxComplete(uint32_t instance);
 uint32_t LPUART_GetChar(uint32_t instance, uint8_t *ch);
 uint32_t LPUART_SetIntMode(uint32_t instance, LPUART_Int_t mode, bool val);
 uint32_t LPUART_DeInit(uint32_t instance);
 void LPUART_SetBaudRate(uint32_t instance, uint32_t baud);
+uint32_t LPUART_EnableRxRing(uint32_t instance, uint8_t *buf, uint32_t size);
+uint32_t LPUART_Read(uint32_t instance, uint8_t *buf, uint32_t max);
+void LPUART_RxPoll(uint32_t instance);
+void LPUART_GetRxStat(uint32_t instance, LPUART_RxStat_t *stat);
+uint32_t LPUART_EnableFlowControl(uint32_t MAP, uint32_t level);
+uint32_t LPUART_EnableRS485(uint32_t instance);
 
 
 #ifdef __cplusplus
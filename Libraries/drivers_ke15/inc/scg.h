@@ -18,10 +18,20 @@ typedef enum
     kSCG_SOSC = 1,
     kSCG_SIRC = 2,
     kSCG_FIRC = 3,
+    kSCG_LPFLL = 5,
     kSCG_PLL = 6,
 }SCG_Mode_t;
 
+/* clock state before ClockProfileEnter */
+typedef struct
+{
+    uint32_t rccr;
+    uint32_t core_clock;
+}ClockProfile_t;
+
 uint32_t ClockSetup(uint32_t opt);
+uint32_t ClockProfileEnter(ClockProfile_t *saved);
+void ClockProfileExit(const ClockProfile_t *saved);
 
 #endif
 
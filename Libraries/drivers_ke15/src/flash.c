@@ -51,21 +51,61 @@
 #define FTF    FTFA
 #endif
 
-static uint8_t _cmd_lunch(void)
+/* typical tersscr and tpgm4/tpgm8 command execution time */
+#define ERASE_TIME_US       (15000)
+#define PROGRAM_TIME_US     ((PROGRAM_CMD == PGM8)?(90):(65))
+
+static FLASH_WaitHook_t s_flash_wait_hook;
+
+static RAMFUNC uint8_t _cmd_lunch(void)
 {
     /* clear command result flags */
     FTF->FSTAT = ACCERR | FPVIOL;
     FTF->FSTAT = CCIF;
-    while(!(FTF->FSTAT & CCIF));
+    while(!(FTF->FSTAT & CCIF))
+    {
+#if (CHLIB_RAMFUNC_SUPPORT == 1)
+        /* only safe when the wait loop itself runs from RAM */
+        if(s_flash_wait_hook)
+        {
+            s_flash_wait_hook();
+        }
+#endif
+    }
     if(FTF->FSTAT & (ACCERR | FPVIOL | MGSTAT0)) return FLASH_ERROR;
     return FLASH_OK;
 }
 
+ /**
+ * @brief  install a function called in the flash command wait loop
+ * @note   only used when CHLIB_RAMFUNC_SUPPORT == 1, hook must be a RAMFUNC and must not access flash
+ * @param  hook: NULL to remove
+ * @retval None
+ */
+void FLASH_SetWaitHook(FLASH_WaitHook_t hook)
+{
+    s_flash_wait_hook = hook;
+}
+
 uint32_t FLASH_GetSectorSize(void)
 {
     return SECTOR_SIZE;
 }
 
+ /**
+ * @brief  get erase/program unit and typical command time
+ * @param  geo: filled by this function
+ * @retval None
+ */
+void FLASH_GetGeometry(FLASH_Geometry_t *geo)
+{
+    geo->erase_unit = SECTOR_SIZE;
+    geo->program_unit = (PROGRAM_CMD == PGM8)?(8):(4);
+    geo->erase_time_us = ERASE_TIME_US;
+    geo->program_time_us = PROGRAM_TIME_US;
+    geo->block_size = 0;    /* single program block, holds the bootloader */
+}
+
 void FLASH_Init(void)
 {
     /* clear status */
@@ -18,6 +18,22 @@ LPUART_Type * const LPUARTBases[] = LPUART_BASES;
 extern bool _is_fitst_init;
 static uint8_t UART_DebugInstance;
 
+/* single producer (IRQ or LPUART_RxPoll with IRQ masked), single consumer (LPUART_Read) ring,
+   kept in RAM with its own base pointer so LPUART_RxPoll can run while flash is busy */
+typedef struct
+{
+    LPUART_Type *base;
+    volatile uint8_t *buf;
+    uint32_t mask;
+    volatile uint32_t in;
+    volatile uint32_t out;
+    uint32_t rts_level;             /* 0: no flow control, else fill level where draining stops */
+    volatile uint32_t paused;       /* RX interrupt off, DATA stays full and RTS is deasserted */
+    LPUART_RxStat_t stat;
+}LPUART_Ring_t;
+
+static LPUART_Ring_t LPUART_RxRing[ARRAY_SIZE(LPUARTBases)];
+
 #if defined(PCC_LPUART0_INDEX)
 static const Reg_t LPUARTClkGate[] =
 {
@@ -255,6 +271,19 @@ void LPUART_PutChar(uint32_t instance, uint8_t ch)
     LPUARTBases[instance]->DATA = (ch & 0xFF);
 }
 
+/**
+ * @brief  wait until the last byte has left the shifter
+ * @note   TC: the transmit buffer is empty and the line is idle. Call it after the last byte was
+ *         handed to the UART
+ * @param  instance:
+ *         @arg HW_LPUARTx : LPUART0-2
+ * @retval None
+ */
+void LPUART_WaitTxComplete(uint32_t instance)
+{
+    while(!(LPUARTBases[instance]->STAT & LPUART_STAT_TC_MASK));
+}
+
 /**
  * @brief  
  * @note   None
@@ -266,6 +295,13 @@ void LPUART_PutChar(uint32_t instance, uint8_t ch)
 uint32_t LPUART_GetChar(uint32_t instance, uint8_t *ch)
 {
     LPUART_Type *LPUARTx = (LPUART_Type*)LPUARTBases[instance];
+    
+    /* receive ring owns the receiver */
+    if(LPUART_RxRing[instance].buf)
+    {
+        return (LPUART_Read(instance, ch, 1) == 1)?(CH_OK):(CH_ERR);
+    }
+    
     if(LPUARTx->STAT & LPUART_STAT_RDRF_MASK)
     {
         *ch = (uint8_t)(LPUARTx->DATA);	
@@ -275,12 +311,180 @@ uint32_t LPUART_GetChar(uint32_t instance, uint8_t *ch)
     if(LPUARTx->STAT & LPUART_STAT_OR_MASK)
     {
         LPUARTx->STAT |= LPUART_STAT_OR_MASK;
-    //    ch = (uint8_t)LPUARTx->DATA;
+        LPUART_RxRing[instance].stat.hw_overrun++;
     }
     
     return CH_ERR;
 }
 
+/**
+ * @brief  receive into a ring buffer from the RX interrupt
+ * @note   LPUART_GetChar and LPUART_Read then read from the ring
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-UART2
+ * @param  buf: ring storage, must stay valid
+ * @param  size: power of 2
+ * @retval CH_OK or CH_ERR
+ */
+uint32_t LPUART_EnableRxRing(uint32_t instance, uint8_t *buf, uint32_t size)
+{
+    LPUART_Ring_t *r = &LPUART_RxRing[instance];
+    
+    if((size == 0) || (size & (size - 1)))
+    {
+        return CH_ERR;
+    }
+    
+    r->base = (LPUART_Type*)LPUARTBases[instance];
+    r->mask = size - 1;
+    r->in = 0;
+    r->out = 0;
+    r->paused = 0;
+    r->buf = buf;
+    
+    r->base->CTRL |= LPUART_CTRL_ORIE_MASK;
+    LPUART_SetIntMode(instance, kLPUART_IntRx, true);
+    return CH_OK;
+}
+
+/**
+ * @brief  move received bytes from the receiver into the ring
+ * @note   called by the IRQ handler, may also be called with interrupts masked
+ *         (e.g. from a flash wait hook), it is a RAMFUNC and only touches RAM and the LPUART
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-UART2
+ * @retval None
+ */
+RAMFUNC void LPUART_RxPoll(uint32_t instance)
+{
+    LPUART_Ring_t *r = &LPUART_RxRing[instance];
+    uint32_t in = r->in;
+    uint8_t ch;
+    
+    if(!r->buf || r->paused)
+    {
+        return;
+    }
+    
+    /* ring above the flow control level: leave the data in the receiver, it deasserts
+       RTS and the sender stops */
+    if(r->rts_level && ((in - r->out) >= r->rts_level))
+    {
+        r->paused = 1;
+        r->base->CTRL &= ~(LPUART_CTRL_RIE_MASK | LPUART_CTRL_ORIE_MASK);
+        return;
+    }
+    
+    while(r->base->STAT & LPUART_STAT_RDRF_MASK)
+    {
+        ch = (uint8_t)r->base->DATA;
+        if((in - r->out) > r->mask)
+        {
+            r->stat.ring_overrun++;
+            continue;
+        }
+        r->buf[in & r->mask] = ch;
+        in++;
+    }
+    r->in = in;
+    
+    if(r->base->STAT & LPUART_STAT_OR_MASK)
+    {
+        r->base->STAT |= LPUART_STAT_OR_MASK;
+        r->stat.hw_overrun++;
+    }
+}
+
+/**
+ * @brief  read up to max bytes from the receive ring
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-UART2
+ * @param  buf: destination
+ * @param  max: size of buf
+ * @retval number of bytes read, 0 if none
+ */
+uint32_t LPUART_Read(uint32_t instance, uint8_t *buf, uint32_t max)
+{
+    LPUART_Ring_t *r = &LPUART_RxRing[instance];
+    uint32_t out = r->out;
+    uint32_t n = 0;
+    
+    if(!r->buf)
+    {
+        return 0;
+    }
+    
+    while((n < max) && (out != r->in))
+    {
+        buf[n++] = r->buf[out & r->mask];
+        out++;
+    }
+    r->out = out;
+    
+    /* room again: the pending RDRF interrupt drains the receiver and RTS is asserted */
+    if(r->paused && ((r->in - out) < r->rts_level))
+    {
+        r->paused = 0;
+        r->base->CTRL |= LPUART_CTRL_RIE_MASK | LPUART_CTRL_ORIE_MASK;
+    }
+    return n;
+}
+
+/**
+ * @brief  enable RTS/CTS hardware flow control
+ * @note   the transmitter waits for CTS, the receiver deasserts RTS while received data is
+ *         not read; with a receive ring the receiver is no longer drained while the ring
+ *         holds level bytes or more, so RTS follows the ring fill
+ * @param  MAP : RTS/CTS pins, same encoding as the LPUART_Init MAP, RTS on the first pin
+ * @param  level : ring fill where RTS is deasserted, 0 for receiver only
+ * @retval instance
+ */
+uint32_t LPUART_EnableFlowControl(uint32_t MAP, uint32_t level)
+{
+    map_t * pq = (map_t*)&(MAP);
+    LPUART_Type *LPUARTx = (LPUART_Type*)LPUARTBases[pq->ip];
+    
+    PIN_SET_MUX;
+#if defined(LPUART_MODIR_RTSWATER_MASK)
+    /* deassert with one FIFO entry still free for the byte in flight */
+    LPUARTx->MODIR &= ~LPUART_MODIR_RTSWATER_MASK;
+    LPUARTx->MODIR |= LPUART_MODIR_RTSWATER(1);
+#endif
+    LPUARTx->MODIR |= LPUART_MODIR_RXRTSE_MASK | LPUART_MODIR_TXCTSE_MASK;
+    LPUART_RxRing[pq->ip].rts_level = level;
+    return pq->ip;
+}
+
+/**
+ * @brief  drive the driver enable of a RS-485 transceiver from RTS
+ * @note   RTS is high from the start bit of the first character until the stop bit of the
+ *         last one has left, so the bus is released without software timing; the pin must
+ *         be muxed to LPUARTx_RTS_b by the caller
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-UART2
+ * @retval CH_OK
+ */
+uint32_t LPUART_EnableRS485(uint32_t instance)
+{
+    LPUART_Type *LPUARTx = (LPUART_Type*)LPUARTBases[instance];
+    
+    LPUARTx->MODIR &= ~(LPUART_MODIR_RXRTSE_MASK | LPUART_MODIR_TXCTSE_MASK);
+    LPUARTx->MODIR |= LPUART_MODIR_TXRTSE_MASK | LPUART_MODIR_TXRTSPOL_MASK;
+    return CH_OK;
+}
+
+/**
+ * @brief  get receive loss counters
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-UART2
+ * @param  stat: filled by this function
+ * @retval None
+ */
+void LPUART_GetRxStat(uint32_t instance, LPUART_RxStat_t *stat)
+{
+    *stat = LPUART_RxRing[instance].stat;
+}
+
 /**
  * @brief  
  * @note   None
@@ -320,24 +524,50 @@ uint32_t LPUART_SetIntMode(uint32_t instance, LPUART_Int_t mode, bool val)
 
 void LPUART_IRQHandler(uint32_t instance)
 {
-    //uint8_t ch;
     LPUART_Type *LPUARTx = (LPUART_Type*)LPUARTBases[instance];
 
-    if(LPUARTx->STAT & LPUART_STAT_TDRE_MASK)
+    if(LPUART_RxRing[instance].buf)
     {
-        /* send data */
-      //  LPUARTx->DATA = (uint8_t)ch;
-    }
-    
-    if(LPUARTx->STAT & LPUART_STAT_RDRF_MASK)
-    {
-    //    ch = (uint8_t)LPUARTx->DATA;
+        LPUART_RxPoll(instance);
+        return;
     }
     
     if(LPUARTx->STAT & LPUART_STAT_OR_MASK)
     {
         LPUARTx->STAT |= LPUART_STAT_OR_MASK;
+        LPUART_RxRing[instance].stat.hw_overrun++;
     }
 }
 
+#if defined(MKE18F16)
+void LPUART0_RX_IRQHandler(void)
+{
+    LPUART_IRQHandler(HW_LPUART0);
+}
+
+void LPUART1_RX_IRQHandler(void)
+{
+    LPUART_IRQHandler(HW_LPUART1);
+}
+#else
+void LPUART0_IRQHandler(void)
+{
+    LPUART_IRQHandler(HW_LPUART0);
+}
+
+#if defined(LPUART1)
+void LPUART1_IRQHandler(void)
+{
+    LPUART_IRQHandler(HW_LPUART1);
+}
+#endif
+
+#if defined(LPUART2)
+void LPUART2_IRQHandler(void)
+{
+    LPUART_IRQHandler(HW_LPUART2);
+}
+#endif
+#endif
+
 #endif
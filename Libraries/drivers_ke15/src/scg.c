@@ -71,6 +71,89 @@ uint32_t ClockSetup(uint32_t opt)
     return CH_OK;
 }
 
+/* update profile: LPFLL at 72MHz on KE1xZ. On KE1xF the SPLL runs at 144MHz from FIRC (8MHz reference,
+   VCO 288MHz) and DIVCORE halves it: flash is only erased and programmed in RUN mode, which allows 80MHz
+   core, 40MHz bus and 24MHz flash clock */
+#if defined(SCG_LPFLLCSR_LPFLLEN_MASK)
+#define PROFILE_MODE            kSCG_LPFLL
+#define PROFILE_CLOCK           (72*1000*1000)
+#define PROFILE_DIVCORE         (0)
+#define PROFILE_CSR             (SCG->LPFLLCSR)
+#define PROFILE_CSR_EN          SCG_LPFLLCSR_LPFLLEN_MASK
+#define PROFILE_CSR_VLD         SCG_LPFLLCSR_LPFLLVLD_MASK
+#else
+#define PROFILE_MODE            kSCG_PLL
+#define PROFILE_CLOCK           (72*1000*1000)
+#define PROFILE_DIVCORE         (1)
+#define PROFILE_CSR             (SCG->SPLLCSR)
+#define PROFILE_CSR_EN          SCG_SPLLCSR_SPLLEN_MASK
+#define PROFILE_CSR_VLD         SCG_SPLLCSR_SPLLVLD_MASK
+#endif
+
+/* bus and slow (flash) clock are divided from the core clock, rounded up to stay within the RUN limits */
+#define PROFILE_DIVBUS          ((PROFILE_CLOCK + 40*1000*1000 - 1)/(40*1000*1000) - 1)
+#define PROFILE_DIVSLOW         ((PROFILE_CLOCK + 24*1000*1000 - 1)/(24*1000*1000) - 1)
+
+#define SCG_WAIT_CNT            (200000)
+
+ /**
+ * @brief  run the core from the profile source, the slow (flash) clock is kept at 24MHz
+ * @note   FIRC stays enabled, so FIRCDIV based functional clocks such as the LPUART's do not change.
+ *         SystemCoreClock follows
+ * @param  saved: filled with the clock state to hand to ClockProfileExit
+ * @retval CH_OK, CH_ERR when not on FIRC or the source is already in use, CH_TIMEOUT
+ */
+uint32_t ClockProfileEnter(ClockProfile_t *saved)
+{
+    uint32_t i, tmp;
+    
+    saved->rccr = SCG->RCCR;
+    saved->core_clock = SystemCoreClock;
+    
+    /* only from the reset state, the way back is then known */
+    if((SCG_GetMode() != kSCG_FIRC) || (PROFILE_CSR & PROFILE_CSR_EN))
+    {
+        return CH_ERR;
+    }
+    
+#if defined(SCG_LPFLLCSR_LPFLLEN_MASK)
+    SCG->LPFLLCFG = SCG_LPFLLCFG_FSEL(1);
+#else
+    SCG->SPLLCFG = SCG_SPLLCFG_SOURCE(1) | SCG_SPLLCFG_MULT(36-16) | SCG_SPLLCFG_PREDIV(6-1);
+#endif
+    PROFILE_CSR = PROFILE_CSR_EN;
+    for(i=0; (i<SCG_WAIT_CNT) && !(PROFILE_CSR & PROFILE_CSR_VLD); i++) {};
+    if(!(PROFILE_CSR & PROFILE_CSR_VLD))
+    {
+        PROFILE_CSR = 0;
+        return CH_TIMEOUT;
+    }
+    
+    tmp = SCG_RCCR_SCS(PROFILE_MODE) | SCG_RCCR_DIVCORE(PROFILE_DIVCORE) | SCG_RCCR_DIVSLOW(PROFILE_DIVSLOW);
+#if defined(SCG_RCCR_DIVBUS_MASK)
+    tmp |= SCG_RCCR_DIVBUS(PROFILE_DIVBUS);
+#endif
+    SCG->RCCR = tmp;
+    while(PROFILE_MODE != SCG_GetMode());
+    
+    SystemCoreClock = PROFILE_CLOCK;
+    return CH_OK;
+}
+
+ /**
+ * @brief  back to the FIRC state ClockProfileEnter started from, the profile source is disabled
+ * @param  saved: clock state from ClockProfileEnter
+ * @retval None
+ */
+void ClockProfileExit(const ClockProfile_t *saved)
+{
+    SCG->RCCR = saved->rccr;
+    while(kSCG_FIRC != SCG_GetMode());
+    PROFILE_CSR = 0;
+    
+    SystemCoreClock = saved->core_clock;
+}
+
 
 #endif
 
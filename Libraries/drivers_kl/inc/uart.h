@@ -47,6 +47,7 @@ typedef enum
 uint32_t UART_Init(uint32_t MAP, uint32_t baudrate);
 uint8_t UART_GetChar(uint32_t instance, uint8_t *ch);
 void UART_PutChar(uint32_t instance, uint8_t ch);
+void UART_WaitTxComplete(uint32_t instance);
 uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val);
 uint32_t UART_SetDMAMode(uint32_t instance, UART_DMA_t mode, bool val);
 void UART_SetBaudRate(uint32_t instance, uint32_t baud);
@@ -56,6 +57,9 @@ void UART_SetBaudRate(uint32_t instance, uint32_t baud);
 #if (CHLIB_DMA_SUPPORT == 1)
 uint32_t UART_DMASend(uint32_t instance, uint32_t dmaChl, uint8_t *buf, uint32_t len);
 uint32_t UART_DMAGetRemain(uint32_t instance);
+uint32_t UART_DMARecvStart(uint32_t instance, uint32_t dmaChl, uint8_t *buf, uint32_t size);
+uint32_t UART_DMARecvRead(uint32_t instance, uint8_t *buf, uint32_t max);
+uint32_t UART_DMARecvGetOverrun(uint32_t instance);
 #endif
 
 
@@ -58,7 +58,7 @@ void DMA_Init(DMA_Init_t *Init)
     DMA0->DMA[Init->chl].DCR |= DMA_DCR_SMOD(Init->sMod);
     /* dest config */
     DMA0->DMA[Init->chl].DAR  = Init->dAddr;
-    DMA0->DMA[Init->chl].DCR |= DMA_DCR_DSIZE(Init->sDataWidth);
+    DMA0->DMA[Init->chl].DCR |= DMA_DCR_DSIZE(Init->dDataWidth);
     (Init->dAddrIsInc)?(DMA0->DMA[Init->chl].DCR |= DMA_DCR_DINC_MASK):(DMA0->DMA[Init->chl].DCR &= ~DMA_DCR_DINC_MASK);
     DMA0->DMA[Init->chl].DCR |= DMA_DCR_DMOD(Init->dMod);
     /* defaut: cycle steal */
@@ -80,7 +80,7 @@ void DMA_Init(DMA_Init_t *Init)
  */
 uint32_t DMA_GetTransCnt(uint8_t chl)
 {
-    return (DMA0->DMA[chl].DSR_BCR & 0x0000FFFF )>>DMA_DSR_BCR_BCR_SHIFT;
+    return (DMA0->DMA[chl].DSR_BCR & DMA_DSR_BCR_BCR_MASK)>>DMA_DSR_BCR_BCR_SHIFT;
 }
 
 void DMA_SetTransCnt(uint8_t chl, uint32_t val)
@@ -193,6 +193,20 @@ void UART_PutChar(uint32_t instance, uint8_t ch)
     UARTx->D = (uint8_t)ch;
 }
 
+/**
+ * @brief  wait until the last byte has left the shifter
+ * @note   TC: the transmit buffer is empty and the line is idle. Call it after the last byte was
+ *         handed to the UART, with UART_DMASend once UART_DMAGetRemain returns 0
+ * @param  instance:
+ *         @arg HW_UARTx : UART0-2
+ * @retval None
+ */
+void UART_WaitTxComplete(uint32_t instance)
+{
+    UART_Type * UARTx = (UART_Type*)UART_IPTbl[instance];
+    while(!(UARTx->S1 & UART_S1_TC_MASK));
+}
+
 uint8_t UART_GetChar(uint32_t instance, uint8_t *ch)
 {
     UART_Type * UARTx = (UART_Type*)UART_IPTbl[instance];
@@ -294,6 +308,154 @@ uint32_t UART_DMAGetRemain(uint32_t instance)
     return ret;
 }
 
+/* DMA receive ring: the channel runs forever into a modulo wrapped buffer */
+#define UART_DMA_RX_BCR         (0xFFF0U)
+
+typedef struct
+{
+    uint8_t     *buf;
+    uint32_t    mask;
+    uint32_t    out;
+    uint32_t    bcr;
+    uint32_t    pending;
+    uint32_t    overrun;
+    uint8_t     dmaChl;
+    bool        isActive;
+}UART_DMARing_t;
+
+static UART_DMARing_t UART_DMARxRing[3];
+
+static const uint8_t UART_DMARxTrigTbl[] = {UART0_REV_DMAREQ, UART1_REV_DMAREQ, UART2_REV_DMAREQ};
+
+ /**
+ * @brief  start receiving into a circular buffer by DMA, no CPU per byte
+ * @note   the destination wraps by DMA modulo addressing, so size must be a power of 2
+ *         between 16 and 256K and buf must be aligned to size, e.g.
+ *         static uint8_t buf[256] __attribute__((aligned(256)));
+ *         the buffer must hold all bytes arriving between two UART_DMARecvRead calls
+ * @param  instance: HW_UART0, HW_UART1, HW_UART2
+ * @param  dmaChl: DMA channel, must not be shared with UART_DMASend
+ * @param  buf: ring buffer
+ * @param  size: ring size in bytes
+ * @retval 0: ok, 1: size or alignment not usable
+ */
+uint32_t UART_DMARecvStart(uint32_t instance, uint32_t dmaChl, uint8_t *buf, uint32_t size)
+{
+    DMA_Init_t Init;
+    DMA_Modulo_Type mod;
+    UART_DMARing_t *r = &UART_DMARxRing[instance];
+    UART_Type * UARTx = (UART_Type*)UART_IPTbl[instance];
+    
+    if((size < 16) || (size > 256*1024) || (size & (size - 1)) || ((uint32_t)buf & (size - 1)))
+    {
+        return 1;
+    }
+    
+    /* 16 bytes is kDMA_Modulo16bytes, each step doubles */
+    mod = kDMA_Modulo16bytes;
+    while((16U << (mod - 1)) < size)
+    {
+        mod = (DMA_Modulo_Type)(mod + 1);
+    }
+    
+    r->buf = buf;
+    r->mask = size - 1;
+    r->out = 0;
+    r->bcr = UART_DMA_RX_BCR;
+    r->pending = 0;
+    r->overrun = 0;
+    r->dmaChl = dmaChl;
+    
+    Init.chl = dmaChl;
+    Init.chlTrigSrc = UART_DMARxTrigTbl[instance];
+    Init.trigSrcMod = kDMA_TrigSrc_Normal;
+    Init.transCnt = UART_DMA_RX_BCR;
+
+    Init.sAddr = (uint32_t)&UARTx->D;
+    Init.sAddrIsInc = false;
+    Init.sDataWidth = kDMA_DataWidthBit_8;
+    Init.sMod = kDMA_ModuloDisable;
+
+    Init.dAddr = (uint32_t)buf;
+    Init.dAddrIsInc = true;
+    Init.dDataWidth = kDMA_DataWidthBit_8;
+    Init.dMod = mod;
+    DMA_Init(&Init);
+    
+    /* keep the request enabled, BCR is reloaded by UART_DMARecvRead */
+    DMA_EnableAutoDisableRequest(dmaChl, false);
+    DMA_EnableReq(dmaChl);
+    
+    if(instance == HW_UART0)
+    {
+        UART0->C5 |= UART0_C5_RDMAE_MASK;
+    }
+    else
+    {
+        /* UART1/2 route the RDRF request to DMA when RIE is set too */
+        UARTx->C4 |= UART_C4_RDMAS_MASK;
+        UARTx->C2 |= UART_C2_RIE_MASK;
+    }
+    r->isActive = true;
+    return 0;
+}
+
+ /**
+ * @brief  copy the bytes the DMA has written since the last call
+ * @note   the producer index is the DMA destination address inside the ring, the byte
+ *         count is decremented once per byte and tells when the ring has been overrun;
+ *         on overrun the ring is resynchronized and the old bytes are dropped
+ * @param  instance: HW_UART0, HW_UART1, HW_UART2
+ * @param  buf: destination
+ * @param  max: size of buf
+ * @retval number of bytes copied
+ */
+uint32_t UART_DMARecvRead(uint32_t instance, uint8_t *buf, uint32_t max)
+{
+    uint32_t in, bcr, cnt, n;
+    UART_DMARing_t *r = &UART_DMARxRing[instance];
+    
+    if(r->isActive == false)
+    {
+        return 0;
+    }
+    
+    in = (DMA_GetDestAddr(r->dmaChl) - (uint32_t)r->buf) & r->mask;
+    bcr = DMA_GetTransCnt(r->dmaChl);
+    r->pending += r->bcr - bcr;
+    
+    /* the channel stops when BCR reaches 0, reload long before */
+    if(bcr < (UART_DMA_RX_BCR / 2))
+    {
+        DMA_SetTransCnt(r->dmaChl, UART_DMA_RX_BCR);
+        bcr = UART_DMA_RX_BCR;
+    }
+    r->bcr = bcr;
+    
+    /* more unread bytes than the ring holds: the oldest are overwritten */
+    if(r->pending > r->mask)
+    {
+        r->overrun++;
+        r->out = in;
+        r->pending = 0;
+    }
+    
+    cnt = (in - r->out) & r->mask;
+    n = 0;
+    while((n < max) && (n < cnt))
+    {
+        buf[n++] = r->buf[r->out];
+        r->out = (r->out + 1) & r->mask;
+    }
+    r->pending = (r->pending > n)?(r->pending - n):(0);
+    return n;
+}
+
+uint32_t UART_DMARecvGetOverrun(uint32_t instance)
+{
+    return UART_DMARxRing[instance].overrun;
+}
+
 #endif
 
 
@@ -45,6 +45,17 @@ void UART_PutChar(uint32_t instance, uint8_t ch)
     UARTBases[instance]->TXDAT  = ch;             // Write the character to the TX buffer
 }
 
+/**
+ * @brief  wait until the last byte has left the shifter
+ * @note   TXIDLE: the transmit buffer is empty and the line is idle
+ * @param  instance: HW_UART0 or HW_UART1
+ * @retval None
+ */
+void UART_WaitTxComplete(uint32_t instance)
+{
+    while (!((UARTBases[instance]->STAT) & (1<<3))); // Wait for TX Idle
+}
+
 uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val)
 {
     (val)?(UARTBases[instance]->INTENSET = (1<<0)):(UARTBases[instance] ->INTENCLR = (1<<0));
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "bl_burst.h"
+#include "kptl.h"
+
+#define BURST_ALIGN_UP(x, a)    (((x) + (a) - 1) & ~((a) - 1))
+
+static void burst_read(bl_burst_t *ctx, uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    if(ctx->op_read)
+    {
+        ctx->op_read(addr, buf, len);
+    }
+    else
+    {
+        memcpy(buf, (void*)(uintptr_t)addr, len);
+    }
+}
+
+/* len must be a multiple of 4 */
+static int is_blank(bl_burst_t *ctx, uint32_t addr, uint32_t len)
+{
+    uint32_t buf[8];
+    uint32_t i, n;
+
+    while(len)
+    {
+        n = (len > sizeof(buf))?(sizeof(buf)):(len);
+        burst_read(ctx, addr, (uint8_t*)buf, n);
+        for(i=0; i<n/4; i++)
+        {
+            if(buf[i] != 0xFFFFFFFF) return 0;
+        }
+        addr += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/* CRC32 of what the target holds now */
+static uint32_t target_crc(bl_burst_t *ctx, uint32_t addr, uint32_t len)
+{
+    uint8_t buf[32];
+    uint32_t n, crc = 0;
+
+    while(len)
+    {
+        n = (len > sizeof(buf))?(sizeof(buf)):(len);
+        burst_read(ctx, addr, buf, n);
+        crc32_update(&crc, buf, n);
+        addr += n;
+        len -= n;
+    }
+    return crc;
+}
+
+ /**
+ * @brief  a WriteMemory transfer starts, decide whether it is received into RAM
+ * @note   only a transfer inside the region that starts on an erase unit and fits the buffer, rounded
+ *         up to the program unit, is buffered. Others go to the memory layer as before
+ * @param  ctx: bl_burst instance
+ * @param  addr: start address of the transfer
+ * @param  len: length of the transfer
+ * @retval 1 when the transfer is buffered, 0 otherwise
+ */
+int bl_burst_begin(bl_burst_t *ctx, uint32_t addr, uint32_t len)
+{
+    ctx->active = 0;
+    if((addr < ctx->cfg_start) || (len > ctx->cfg_size) || ((addr - ctx->cfg_start) > (ctx->cfg_size - len)) ||
+       (len == 0) || (addr & (ctx->cfg_erase_unit - 1)) || (len > ctx->cfg_buf_size) ||
+       (BURST_ALIGN_UP(len, ctx->cfg_program_unit) > ctx->cfg_buf_size))
+    {
+        return 0;
+    }
+
+    ctx->start = addr;
+    ctx->len = len;
+    ctx->rx_len = 0;
+    ctx->crc = 0;
+    ctx->err = BL_BURST_OK;
+    ctx->active = 1;
+    return 1;
+}
+
+ /**
+ * @brief  a transfer is being received into RAM
+ * @param  ctx: bl_burst instance
+ * @retval 1 or 0
+ */
+int bl_burst_is_active(bl_burst_t *ctx)
+{
+    return ctx->active;
+}
+
+ /**
+ * @brief  copy data of the transfer into the buffer
+ * @note   data must continue the previous write. Anything else marks the transfer bad, it is then
+ *         refused by bl_burst_commit and flash is left as it was
+ * @param  ctx: bl_burst instance
+ * @param  addr: destination address
+ * @param  buf: data
+ * @param  len: length in bytes
+ * @retval BL_BURST_OK or BL_BURST_ERR_SEQ
+ */
+int bl_burst_write(bl_burst_t *ctx, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    if((ctx->err != BL_BURST_OK) || (addr != ctx->start + ctx->rx_len) || (len > ctx->len - ctx->rx_len))
+    {
+        ctx->err = BL_BURST_ERR_SEQ;
+        return ctx->err;
+    }
+
+    memcpy((uint8_t*)ctx->cfg_buf + ctx->rx_len, buf, len);
+    crc32_update(&ctx->crc, buf, len);
+    ctx->rx_len += len;
+    return BL_BURST_OK;
+}
+
+ /**
+ * @brief  the transfer is complete: program the range
+ * @note   the range must be blank, nothing is erased here, so flash outside the range is never
+ *         touched. The flash is read back after the last program and checked against the CRC
+ *         taken while receiving
+ * @param  ctx: bl_burst instance
+ * @retval BL_BURST_OK or BL_BURST_ERR_xxx
+ */
+int bl_burst_commit(bl_burst_t *ctx)
+{
+    uint8_t *buf = (uint8_t*)ctx->cfg_buf;
+    uint32_t addr, end, n;
+
+    if(!ctx->active)
+    {
+        return BL_BURST_OK;
+    }
+    ctx->active = 0;
+
+    if((ctx->err != BL_BURST_OK) || (ctx->rx_len != ctx->len))
+    {
+        return BL_BURST_ERR_SEQ;
+    }
+
+    /* the last program unit is filled up with the erased value */
+    end = ctx->start + BURST_ALIGN_UP(ctx->len, ctx->cfg_program_unit);
+    memset(buf + ctx->len, 0xFF, end - ctx->start - ctx->len);
+
+    /* the host erases first, as for packet by packet programming. Erasing here would also wipe
+       whatever follows the range in its last erase unit */
+    if(!is_blank(ctx, ctx->start, end - ctx->start))
+    {
+        return BL_BURST_ERR_NOT_ERASED;
+    }
+
+    for(addr = ctx->start; addr < end; addr += n)
+    {
+        n = (end - addr < ctx->cfg_erase_unit)?(end - addr):(ctx->cfg_erase_unit);
+        if(ctx->op_program(addr, buf + (addr - ctx->start), n))
+        {
+            return BL_BURST_ERR_FLASH;
+        }
+    }
+
+    return (target_crc(ctx, ctx->start, ctx->len) == ctx->crc)?(BL_BURST_OK):(BL_BURST_ERR_CRC);
+}
+
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __BL_BURST_H__
+#define __BL_BURST_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* return code */
+#define BL_BURST_OK             (0)
+#define BL_BURST_ERR_SEQ        (1)     /* data out of order or beyond the transfer, nothing is programmed */
+#define BL_BURST_ERR_CRC        (2)     /* flash read back differs from the data received */
+#define BL_BURST_ERR_FLASH      (3)
+#define BL_BURST_ERR_NOT_ERASED (4)     /* destination not blank, nothing is programmed */
+
+/* one WriteMemory transfer received into RAM first: flash is not touched while the data comes in,
+   then the range, erased by the host beforehand, is programmed sector by sector in one go. A transfer
+   cut off before its end leaves flash as it was */
+typedef struct
+{
+    uint32_t cfg_start;             /* target region, transfers reaching outside it are not buffered */
+    uint32_t cfg_size;
+    uint32_t *cfg_buf;              /* receive buffer in RAM */
+    uint32_t cfg_buf_size;          /* larger transfers are not buffered */
+    uint32_t cfg_erase_unit;        /* power of 2 */
+    uint32_t cfg_program_unit;      /* power of 2 */
+
+    /* raw primitives of the target memory, return 0 on success. op_program gets whole program units
+       inside one erase unit, buf 4 bytes aligned */
+    int (*op_program)(uint32_t addr, const uint8_t *buf, uint32_t len);
+    int (*op_read)(uint32_t addr, uint8_t *buf, uint32_t len);     /* optional, NULL: target is memory mapped */
+
+    /* bl_burst private resource */
+    uint32_t start;
+    uint32_t len;
+    uint32_t rx_len;
+    uint32_t crc;                   /* running CRC32 of the received data */
+    uint8_t  active;
+    uint8_t  err;
+}bl_burst_t;
+
+
+int bl_burst_begin(bl_burst_t *ctx, uint32_t addr, uint32_t len);
+int bl_burst_is_active(bl_burst_t *ctx);
+int bl_burst_write(bl_burst_t *ctx, uint32_t addr, const uint8_t *buf, uint32_t len);
+int bl_burst_commit(bl_burst_t *ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
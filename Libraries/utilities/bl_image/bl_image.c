@@ -0,0 +1,167 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "bl_image.h"
+#include "kptl.h"
+
+#define VERDICT_MAGIC           (0x4B4F4942UL)      /* "BIOK" */
+
+/* one verified image, a slot holds one record padded to the program unit */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t base;
+    uint32_t len;
+    uint32_t crc;
+}verdict_t;
+
+static int is_blank(uint32_t addr, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t*)addr;
+
+    while(len--)
+    {
+        if(*p++ != 0xFF)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint32_t image_crc(uint32_t base, uint32_t len)
+{
+    uint32_t crc = 0;
+    uint32_t zero = 0;
+
+    /* the crc word itself is counted as 0 */
+    crc32_update(&crc, (const uint8_t*)base, BL_IMAGE_HDR_OFFSET + 4);
+    crc32_update(&crc, (const uint8_t*)&zero, 4);
+    crc32_update(&crc, (const uint8_t*)(base + BL_IMAGE_HDR_OFFSET + 8), len - (BL_IMAGE_HDR_OFFSET + 8));
+    return crc;
+}
+
+static int cache_erase(bl_image_t *ctx)
+{
+    uint32_t addr;
+
+    for(addr = ctx->cfg_cache_addr; addr < ctx->cfg_cache_addr + ctx->cfg_cache_size; addr += ctx->cfg_erase_unit)
+    {
+        if(!is_blank(addr, ctx->cfg_erase_unit) && ctx->op_erase(addr))
+        {
+            return BL_IMAGE_ERR_CFG;
+        }
+    }
+    ctx->cache_blank = 1;
+    return BL_IMAGE_OK;
+}
+
+ /**
+ * @brief  check the configuration and size the cache slots
+ * @param  ctx: cfg_xxx and op_xxx must be filled in
+ * @retval BL_IMAGE_OK or BL_IMAGE_ERR_CFG
+ */
+int bl_image_init(bl_image_t *ctx)
+{
+    ctx->slot_size = ctx->cfg_program_unit;
+    while(ctx->slot_size < sizeof(verdict_t))
+    {
+        ctx->slot_size <<= 1;
+    }
+
+    ctx->cache_blank = 0;
+    if((ctx->slot_size > BL_IMAGE_SLOT_SIZE) || (ctx->cfg_cache_size < ctx->slot_size))
+    {
+        return BL_IMAGE_ERR_CFG;
+    }
+    return BL_IMAGE_OK;
+}
+
+ /**
+ * @brief  validate the image at base against its header
+ * @note   the CRC runs over the whole image only when the cache has no verdict for this header,
+ *         which is once after each download. A verdict is written after a good CRC
+ * @param  ctx: bl_image instance
+ * @param  base: image start, the vector table
+ * @param  hdr: copy of the header, may be NULL
+ * @retval BL_IMAGE_OK when the image may be started, otherwise BL_IMAGE_ERR_xxx
+ */
+int bl_image_check(bl_image_t *ctx, uint32_t base, bl_image_hdr_t *hdr)
+{
+    const bl_image_hdr_t *h = (const bl_image_hdr_t*)(base + BL_IMAGE_HDR_OFFSET);
+    const verdict_t *v;
+    verdict_t *rec = (verdict_t*)ctx->slot;
+    uint32_t addr, end;
+
+    if(hdr)
+    {
+        memcpy(hdr, h, sizeof(bl_image_hdr_t));
+    }
+
+    if((h->len < BL_IMAGE_HDR_OFFSET + sizeof(bl_image_hdr_t)) || (h->len > ctx->cfg_max_size))
+    {
+        return BL_IMAGE_ERR_HEADER;
+    }
+
+    /* records are appended, the first blank slot ends the search */
+    end = ctx->cfg_cache_addr + ctx->cfg_cache_size - ctx->slot_size + 1;
+    for(addr = ctx->cfg_cache_addr; addr < end; addr += ctx->slot_size)
+    {
+        if(is_blank(addr, ctx->slot_size))
+        {
+            break;
+        }
+
+        v = (const verdict_t*)addr;
+        if((v->magic == VERDICT_MAGIC) && (v->base == base) && (v->len == h->len) && (v->crc == h->crc))
+        {
+            return BL_IMAGE_OK;
+        }
+    }
+
+    if(image_crc(base, h->len) != h->crc)
+    {
+        return BL_IMAGE_ERR_CRC;
+    }
+
+    /* remember the verdict, a full cache starts over. A failure only costs a CRC at the next boot */
+    if(addr >= end)
+    {
+        if(cache_erase(ctx) != BL_IMAGE_OK)
+        {
+            return BL_IMAGE_OK;
+        }
+        addr = ctx->cfg_cache_addr;
+    }
+
+    memset(ctx->slot, 0xFF, sizeof(ctx->slot));
+    rec->magic = VERDICT_MAGIC;
+    rec->base = base;
+    rec->len = h->len;
+    rec->crc = h->crc;
+    ctx->op_program(addr, (const uint8_t*)ctx->slot, ctx->slot_size);
+    ctx->cache_blank = 0;
+    return BL_IMAGE_OK;
+}
+
+ /**
+ * @brief  drop all verdicts, called before the first erase or write of a download
+ * @note   cheap when the cache is already blank, so it may be called for every write
+ * @param  ctx: bl_image instance
+ * @retval None
+ */
+void bl_image_invalidate(bl_image_t *ctx)
+{
+    if(ctx->cache_blank)
+    {
+        return;
+    }
+    cache_erase(ctx);
+}
+
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __BL_IMAGE_H__
+#define __BL_IMAGE_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* largest program unit of the cache memory, LPC pages are 64 bytes */
+#ifndef BL_IMAGE_SLOT_SIZE
+#define BL_IMAGE_SLOT_SIZE      (64)
+#endif
+
+/* return code */
+#define BL_IMAGE_OK             (0)
+#define BL_IMAGE_ERR_HEADER     (1)     /* no header, or length out of the region */
+#define BL_IMAGE_ERR_CRC        (2)     /* image incomplete or corrupted */
+#define BL_IMAGE_ERR_CFG        (3)
+
+/* the header lives in the reserved Cortex-M vector table words 8..10 (0x20..0x2B), 0x1C is left to the
+   LPC vector checksum. pc_tool/image_patch fills it into the application binary after the build */
+#define BL_IMAGE_HDR_OFFSET     (0x20)
+
+typedef struct
+{
+    uint32_t len;               /* image length in bytes from the vector table */
+    uint32_t crc;               /* CRC32 (zlib) of the image, this word counted as 0 */
+    uint32_t version;           /* free for the application, covered by the CRC */
+}bl_image_hdr_t;
+
+typedef struct
+{
+    uint32_t cfg_max_size;      /* largest accepted image length */
+
+    /* verdict cache: a memory mapped area outside every image, a data flash sector or the KE EEPROM */
+    uint32_t cfg_cache_addr;
+    uint32_t cfg_cache_size;    /* n * cfg_erase_unit */
+    uint32_t cfg_erase_unit;
+    uint32_t cfg_program_unit;  /* <= BL_IMAGE_SLOT_SIZE */
+
+    /* raw primitives of the cache memory, return 0 on success */
+    int (*op_erase)(uint32_t addr);
+    int (*op_program)(uint32_t addr, const uint8_t *buf, uint32_t len);
+
+    /* bl_image private resource */
+    uint32_t slot[BL_IMAGE_SLOT_SIZE/4];
+    uint32_t slot_size;
+    uint8_t  cache_blank;       /* the cache is known to be erased */
+}bl_image_t;
+
+
+int bl_image_init(bl_image_t *ctx);
+int bl_image_check(bl_image_t *ctx, uint32_t base, bl_image_hdr_t *hdr);
+void bl_image_invalidate(bl_image_t *ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "bl_journal.h"
+#include "kptl.h"
+
+#define HDR_MAGIC               (0x4C4E524AUL)      /* "JRNL" */
+#define SEC_MAGIC               (0x53434553UL)      /* "SECS" */
+
+/* first record of the journal */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t start;
+    uint32_t len;
+    uint32_t crc;               /* CRC32 of the words above */
+}jrnl_hdr_t;
+
+/* one completed sector */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t idx;               /* sector index from the sector holding start */
+    uint32_t crc;               /* CRC32 of the sector's bytes inside the range */
+    uint32_t inv;               /* ~idx */
+}jrnl_sec_t;
+
+static int is_blank(uint32_t addr, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t*)addr;
+
+    while(len--)
+    {
+        if(*p++ != 0xFF)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint32_t hdr_crc(const jrnl_hdr_t *h)
+{
+    uint32_t crc = 0;
+
+    crc32_update(&crc, (const uint8_t*)h, 12);
+    return crc;
+}
+
+static uint32_t sec_base(bl_journal_t *ctx)
+{
+    return ctx->start & ~(ctx->cfg_sector_size - 1);
+}
+
+/* end of the sector holding addr, clipped to the range */
+static uint32_t sec_end(bl_journal_t *ctx, uint32_t addr)
+{
+    uint32_t end = (addr & ~(ctx->cfg_sector_size - 1)) + ctx->cfg_sector_size;
+
+    return (end < ctx->start + ctx->len)?(end):(ctx->start + ctx->len);
+}
+
+static int append(bl_journal_t *ctx, const void *rec, uint32_t size)
+{
+    int ret;
+
+    if(ctx->next_rec == 0)
+    {
+        return 1;
+    }
+
+    memset(ctx->rec, 0xFF, sizeof(ctx->rec));
+    memcpy(ctx->rec, rec, size);
+    ret = ctx->op_program(ctx->next_rec, (const uint8_t*)ctx->rec, ctx->rec_size);
+
+    ctx->next_rec += ctx->rec_size;
+    if(ctx->next_rec + ctx->rec_size > ctx->cfg_addr + ctx->cfg_size)
+    {
+        ctx->next_rec = 0;
+    }
+    return ret;
+}
+
+/* the sector holding addr is in flash */
+static void log_sector(bl_journal_t *ctx, uint32_t addr)
+{
+    jrnl_sec_t s;
+
+    s.magic = SEC_MAGIC;
+    s.idx = (addr - sec_base(ctx)) / ctx->cfg_sector_size;
+    s.crc = ctx->sec_crc;
+    s.inv = ~s.idx;
+    if(append(ctx, &s, sizeof(s)))
+    {
+        ctx->tracking = 0;
+    }
+    ctx->sec_crc = 0;
+}
+
+ /**
+ * @brief  load the journal left by a previous session
+ * @param  ctx: cfg_xxx and op_xxx must be filled in
+ * @retval 0 or 1 on a bad configuration
+ */
+int bl_journal_init(bl_journal_t *ctx)
+{
+    const jrnl_hdr_t *h = (const jrnl_hdr_t*)ctx->cfg_addr;
+    uint32_t addr;
+
+    ctx->rec_size = ctx->cfg_program_unit;
+    while(ctx->rec_size < sizeof(jrnl_sec_t))
+    {
+        ctx->rec_size <<= 1;
+    }
+
+    ctx->tracking = 0;
+    ctx->start = 0;
+    ctx->len = 0;
+    ctx->next_rec = 0;
+    if((ctx->rec_size > BL_JOURNAL_REC_SIZE) || (ctx->cfg_size < 2 * ctx->rec_size))
+    {
+        return 1;
+    }
+
+    if((h->magic == HDR_MAGIC) && (h->crc == hdr_crc(h)))
+    {
+        ctx->start = h->start;
+        ctx->len = h->len;
+
+        /* records are appended, a torn one is skipped */
+        for(addr = ctx->cfg_addr + ctx->rec_size; addr + ctx->rec_size <= ctx->cfg_addr + ctx->cfg_size; addr += ctx->rec_size)
+        {
+            if(is_blank(addr, ctx->rec_size))
+            {
+                ctx->next_rec = addr;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+ /**
+ * @brief  a WriteMemory transfer starts
+ * @note   a transfer that starts on a sector boundary inside the journaled range and ends at its end
+ *         continues the journal, any other one starts a new journal
+ * @param  ctx: bl_journal instance
+ * @param  addr: start address of the transfer
+ * @param  len: length of the transfer
+ * @retval None
+ */
+void bl_journal_begin(bl_journal_t *ctx, uint32_t addr, uint32_t len)
+{
+    jrnl_hdr_t h;
+    uint32_t a;
+
+    ctx->tracking = 0;
+    if((ctx->len == 0) || (addr <= ctx->start) || (addr + len != ctx->start + ctx->len) || (addr & (ctx->cfg_sector_size - 1)))
+    {
+        ctx->start = addr;
+        ctx->len = len;
+        ctx->next_rec = ctx->cfg_addr;
+        for(a = ctx->cfg_addr; a < ctx->cfg_addr + ctx->cfg_size; a += ctx->cfg_erase_unit)
+        {
+            if(!is_blank(a, ctx->cfg_erase_unit) && ctx->op_erase(a))
+            {
+                ctx->next_rec = 0;
+            }
+        }
+
+        h.magic = HDR_MAGIC;
+        h.start = addr;
+        h.len = len;
+        h.crc = hdr_crc(&h);
+        if(append(ctx, &h, sizeof(h)))
+        {
+            ctx->next_rec = 0;
+        }
+    }
+
+    ctx->exp_addr = addr;
+    ctx->sec_crc = 0;
+    ctx->tracking = (ctx->next_rec != 0);
+}
+
+ /**
+ * @brief  data of the transfer was handed to the memory layer
+ * @note   call after the write, a sector is logged once the write reaches its end. Writes that do not
+ *         continue the previous one stop the tracking until the next bl_journal_begin
+ * @param  ctx: bl_journal instance
+ * @param  addr: destination address
+ * @param  buf: data
+ * @param  len: length in bytes
+ * @retval None
+ */
+void bl_journal_write(bl_journal_t *ctx, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    uint32_t end, n;
+
+    if(!ctx->tracking || (addr != ctx->exp_addr) || (len > ctx->start + ctx->len - addr))
+    {
+        ctx->tracking = 0;
+        return;
+    }
+
+    while(len && ctx->tracking)
+    {
+        end = sec_end(ctx, addr);
+        n = (len < end - addr)?(len):(end - addr);
+        crc32_update(&ctx->sec_crc, buf, n);
+        addr += n;
+        buf += n;
+        len -= n;
+
+        /* the last sector may end in a partial program unit, it is logged by bl_journal_flush */
+        if((addr == end) && (end != ctx->start + ctx->len))
+        {
+            log_sector(ctx, addr - 1);
+        }
+    }
+    ctx->exp_addr = addr;
+}
+
+ /**
+ * @brief  the memory layer has written everything, called after its flush
+ * @param  ctx: bl_journal instance
+ * @retval None
+ */
+void bl_journal_flush(bl_journal_t *ctx)
+{
+    if(ctx->tracking && (ctx->exp_addr == ctx->start + ctx->len))
+    {
+        log_sector(ctx, ctx->exp_addr - 1);
+        ctx->tracking = 0;
+    }
+}
+
+ /**
+ * @brief  where an interrupted transfer continues
+ * @note   every logged sector is checked against its CRC, a sector erased or changed since is not complete
+ * @param  ctx: bl_journal instance
+ * @param  start: journaled range, 0 if there is no journal
+ * @param  len: journaled range, 0 if there is no journal
+ * @retval first address that is not complete, start + len when the transfer completed
+ */
+uint32_t bl_journal_resume(bl_journal_t *ctx, uint32_t *start, uint32_t *len)
+{
+    const jrnl_sec_t *s;
+    uint32_t addr, end, idx, crc, r;
+
+    *start = ctx->start;
+    *len = ctx->len;
+
+    for(addr = ctx->start; addr < ctx->start + ctx->len; addr = end)
+    {
+        end = sec_end(ctx, addr);
+        idx = (addr - sec_base(ctx)) / ctx->cfg_sector_size;
+        crc = 0;
+        crc32_update(&crc, (const uint8_t*)addr, end - addr);
+
+        for(r = ctx->cfg_addr + ctx->rec_size; r + ctx->rec_size <= ctx->cfg_addr + ctx->cfg_size; r += ctx->rec_size)
+        {
+            s = (const jrnl_sec_t*)r;
+            if((s->magic == SEC_MAGIC) && (s->idx == idx) && (s->inv == ~idx) && (s->crc == crc))
+            {
+                break;
+            }
+        }
+
+        if(r + ctx->rec_size > ctx->cfg_addr + ctx->cfg_size)
+        {
+            break;
+        }
+    }
+    return addr;
+}
+
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __BL_JOURNAL_H__
+#define __BL_JOURNAL_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* largest program unit of the journal memory */
+#ifndef BL_JOURNAL_REC_SIZE
+#define BL_JOURNAL_REC_SIZE     (64)
+#endif
+
+/* GetProperty tag of the journal: start, length and resume address of the last WriteMemory */
+#define BL_JOURNAL_PROPERTY     (0x80)
+
+/* progress of one WriteMemory transfer kept in flash across resets: a header with the target range,
+   then one record per completed sector with the CRC32 of the sector's data. A record is appended
+   only after its sector is fully programmed, so the journal never claims data that is not in flash */
+typedef struct
+{
+    uint32_t cfg_addr;              /* journal area, one or more erase units outside the target */
+    uint32_t cfg_size;
+    uint32_t cfg_erase_unit;
+    uint32_t cfg_program_unit;      /* <= BL_JOURNAL_REC_SIZE */
+    uint32_t cfg_sector_size;       /* tracking granularity in the target, power of 2 */
+
+    /* raw primitives of the journal memory, return 0 on success */
+    int (*op_erase)(uint32_t addr);
+    int (*op_program)(uint32_t addr, const uint8_t *buf, uint32_t len);
+
+    /* bl_journal private resource */
+    uint32_t rec[BL_JOURNAL_REC_SIZE/4];
+    uint32_t rec_size;
+    uint32_t start;                 /* target range */
+    uint32_t len;
+    uint32_t next_rec;              /* where the next record goes, 0: journal full or broken */
+    uint32_t exp_addr;              /* writes are tracked while they continue from here */
+    uint32_t sec_crc;               /* running CRC of the current sector */
+    uint8_t  tracking;
+}bl_journal_t;
+
+
+int bl_journal_init(bl_journal_t *ctx);
+void bl_journal_begin(bl_journal_t *ctx, uint32_t addr, uint32_t len);
+void bl_journal_write(bl_journal_t *ctx, uint32_t addr, const uint8_t *buf, uint32_t len);
+void bl_journal_flush(bl_journal_t *ctx);
+uint32_t bl_journal_resume(bl_journal_t *ctx, uint32_t *start, uint32_t *len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
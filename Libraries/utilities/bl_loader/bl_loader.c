@@ -0,0 +1,46 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "bl_loader.h"
+#include "kptl.h"
+
+ /**
+ * @brief  check the loader blob at addr and run it
+ * @note   the header, the entry and the whole blob must lie in the RAM window of api, and the CRC
+ *         must match, so a partly written or stale blob is never entered
+ * @param  api: services and limits handed to the loader
+ * @param  addr: blob address, the first parameter of Call
+ * @param  arg: passed to the loader, the second parameter of Call
+ * @retval status of the loader, or BL_LOADER_ERR_xxx
+ */
+uint32_t bl_loader_call(const bl_loader_api_t *api, uint32_t addr, uint32_t arg)
+{
+    const bl_loader_hdr_t *h = (const bl_loader_hdr_t*)addr;
+    uint32_t entry, crc = 0;
+
+    if((addr & 3) || (addr < api->ram_start) || (api->ram_size < sizeof(bl_loader_hdr_t)) ||
+       ((addr - api->ram_start) > (api->ram_size - sizeof(bl_loader_hdr_t))))
+    {
+        return BL_LOADER_ERR_HEADER;
+    }
+
+    entry = h->entry & ~1UL;
+    if((h->magic != BL_LOADER_MAGIC) || (h->abi != BL_LOADER_ABI) || (h->size < sizeof(bl_loader_hdr_t)) ||
+       (h->size > (api->ram_start + api->ram_size - addr)) || (entry < addr + sizeof(bl_loader_hdr_t)) || (entry >= addr + h->size))
+    {
+        return BL_LOADER_ERR_HEADER;
+    }
+
+    crc32_update(&crc, (const uint8_t*)(addr + sizeof(bl_loader_hdr_t)), h->size - sizeof(bl_loader_hdr_t));
+    if(crc != h->crc)
+    {
+        return BL_LOADER_ERR_CRC;
+    }
+
+    return ((bl_loader_entry_t)(entry | 1))(api, arg);
+}
+
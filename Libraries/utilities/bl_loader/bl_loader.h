@@ -0,0 +1,73 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __BL_LOADER_H__
+#define __BL_LOADER_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define BL_LOADER_MAGIC         (0x444C4C42UL)      /* "BLLD" */
+#define BL_LOADER_ABI           (1)
+
+/* status of a Call the bootloader refused, anything else comes from the loader */
+#define BL_LOADER_ERR_HEADER    (0x4C440001UL)      /* no header, wrong ABI, or blob outside the RAM window */
+#define BL_LOADER_ERR_CRC       (0x4C440002UL)      /* blob incomplete or corrupted */
+
+/* a flash loader is a blob the host writes into the RAM window with WriteMemory and starts with
+   Call <blob address> <arg>. It is linked for its load address and starts with this header */
+typedef struct
+{
+    uint32_t magic;             /* BL_LOADER_MAGIC */
+    uint32_t abi;               /* BL_LOADER_ABI the loader was built for */
+    uint32_t entry;             /* absolute address of the entry inside the blob, Thumb bit optional */
+    uint32_t size;              /* blob length in bytes, header included */
+    uint32_t crc;               /* CRC32 (zlib) of the blob after the header */
+}bl_loader_hdr_t;
+
+/* what the bootloader hands to the loader. Flash addresses are the ones the host uses for WriteMemory,
+   the services check them against the flash region and return 0 on success */
+typedef struct
+{
+    uint32_t abi;
+    uint32_t flash_start;       /* region the loader may change */
+    uint32_t flash_size;
+    uint32_t erase_unit;
+    uint32_t program_unit;
+    uint32_t ram_start;         /* RAM window, the loader may use all of it, nothing else */
+    uint32_t ram_size;
+    uint32_t core_clock;
+
+    /* flash, the same path as FlashEraseRegion and WriteMemory: any alignment, write after erase */
+    int (*erase)(uint32_t addr, uint32_t len);
+    int (*write)(uint32_t addr, uint8_t *buf, uint32_t len);
+    int (*flush)(void);         /* call before returning when write was used */
+    int (*read)(uint32_t addr, uint8_t *buf, uint32_t len);
+
+    /* the host link, for loaders that receive their data themselves instead of through WriteMemory */
+    uint32_t (*link_read)(uint8_t *buf, uint32_t len);     /* does not block, returns the bytes read */
+    int (*link_send)(uint8_t *buf, uint32_t len);
+}bl_loader_api_t;
+
+/* entry, AAPCS: called from the bootloader main loop on its stack with interrupts as they are there.
+   The loader may drive the flash controller and the clocks itself, it restores the clocks before it
+   returns. The return value is the status of the Call response */
+typedef uint32_t (*bl_loader_entry_t)(const bl_loader_api_t *api, uint32_t arg);
+
+
+uint32_t bl_loader_call(const bl_loader_api_t *api, uint32_t addr, uint32_t arg);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
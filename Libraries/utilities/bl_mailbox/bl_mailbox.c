@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "bl_mailbox.h"
+
+/* CRC32 (IEEE 802.3) over whole words, small enough for both images */
+static uint32_t mailbox_crc(const uint32_t *w, uint32_t cnt)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    uint32_t i, j;
+
+    for(i=0; i<cnt*4; i++)
+    {
+        crc ^= (w[i/4] >> ((i%4)*8)) & 0xFF;
+        for(j=0; j<8; j++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+ /**
+ * @brief  leave a request for the bootloader, called by the application before NVIC_SystemReset
+ * @param  mb: mailbox, BL_MAILBOX_ADDR of the board
+ * @param  cmd: BL_MAILBOX_CMD_xxx
+ * @param  arg: passed to the bootloader
+ * @retval None
+ */
+void bl_mailbox_post(bl_mailbox_t *mb, uint32_t cmd, uint32_t arg)
+{
+    mb->magic = BL_MAILBOX_MAGIC;
+    mb->cmd = cmd;
+    mb->arg = arg;
+    mb->crc = mailbox_crc((uint32_t*)mb, 3);
+}
+
+ /**
+ * @brief  read and clear the request, called once by the bootloader right after reset
+ * @param  mb: mailbox, BL_MAILBOX_ADDR of the board
+ * @param  arg: request argument, may be NULL
+ * @retval BL_MAILBOX_CMD_xxx, BL_MAILBOX_CMD_NONE if the mailbox holds no valid request
+ */
+uint32_t bl_mailbox_take(bl_mailbox_t *mb, uint32_t *arg)
+{
+    uint32_t cmd = BL_MAILBOX_CMD_NONE;
+
+    if((mb->magic == BL_MAILBOX_MAGIC) && (mb->crc == mailbox_crc((uint32_t*)mb, 3)))
+    {
+        cmd = mb->cmd;
+        if(arg)
+        {
+            *arg = mb->arg;
+        }
+    }
+
+    /* a request is served once, the next reset boots normally */
+    mb->magic = 0;
+    mb->crc = 0;
+    return cmd;
+}
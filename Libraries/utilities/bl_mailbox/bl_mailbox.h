@@ -0,0 +1,44 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __BL_MAILBOX_H__
+#define __BL_MAILBOX_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define BL_MAILBOX_MAGIC            (0x584F424DUL)      /* "MBOX" */
+
+/* requests from the application */
+#define BL_MAILBOX_CMD_NONE         (0x00)
+#define BL_MAILBOX_CMD_ENTER        (0x01)              /* stay in the bootloader until a host connects */
+
+/* 16 bytes of RAM at BL_MAILBOX_ADDR (bl_cfg.h), right after the bootloader IRAM. SRAM keeps it
+   across NVIC_SystemReset. The application must keep it out of its own RAM as well: its IRAM or
+   scatter file ends at BL_MAILBOX_ADDR, as in the example application projects */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t cmd;
+    uint32_t arg;
+    uint32_t crc;               /* CRC32 of the words above, RAM content after power on never matches */
+}bl_mailbox_t;
+
+
+void bl_mailbox_post(bl_mailbox_t *mb, uint32_t cmd, uint32_t arg);
+uint32_t bl_mailbox_take(bl_mailbox_t *mb, uint32_t *arg);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <string.h>
+
+#include "bl_slot.h"
+#include "kptl.h"
+
+#define SLOT_MAGIC              (0x544F4C53UL)      /* "SLOT" */
+
+/* one activation, padded to the program unit */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t active;
+    uint32_t crc;               /* CRC32 of the words above */
+}slot_rec_t;
+
+static int is_blank(uint32_t addr, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t*)addr;
+
+    while(len--)
+    {
+        if(*p++ != 0xFF)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static uint32_t rec_crc(const slot_rec_t *r)
+{
+    uint32_t crc = 0;
+
+    crc32_update(&crc, (const uint8_t*)r, 12);
+    return crc;
+}
+
+static int rec_valid(const slot_rec_t *r)
+{
+    return (r->magic == SLOT_MAGIC) && (r->active < BL_SLOT_NUM) && (r->crc == rec_crc(r));
+}
+
+/* first blank record behind addr in its erase unit, otherwise the start of the other unit */
+static uint32_t next_free(bl_slot_t *ctx, uint32_t addr)
+{
+    uint32_t unit = (addr - ctx->cfg_table_addr) / ctx->cfg_erase_unit;
+    uint32_t end = ctx->cfg_table_addr + (unit + 1) * ctx->cfg_erase_unit;
+
+    for(addr += ctx->rec_size; addr + ctx->rec_size <= end; addr += ctx->rec_size)
+    {
+        if(is_blank(addr, ctx->rec_size))
+        {
+            return addr;
+        }
+    }
+    return ctx->cfg_table_addr + (1 - unit) * ctx->cfg_erase_unit;
+}
+
+ /**
+ * @brief  load the current activation from the slot table
+ * @note   an empty table activates slot 0
+ * @param  ctx: cfg_xxx and op_xxx must be filled in
+ * @retval BL_SLOT_OK or BL_SLOT_ERR_CFG
+ */
+int bl_slot_init(bl_slot_t *ctx)
+{
+    const slot_rec_t *r;
+    uint32_t addr, last = 0;
+
+    ctx->rec_size = ctx->cfg_program_unit;
+    while(ctx->rec_size < sizeof(slot_rec_t))
+    {
+        ctx->rec_size <<= 1;
+    }
+    if((ctx->rec_size > BL_SLOT_REC_SIZE) || (ctx->cfg_erase_unit < ctx->rec_size))
+    {
+        return BL_SLOT_ERR_CFG;
+    }
+
+    ctx->seq = 0;
+    ctx->active = 0;
+    ctx->next_addr = ctx->cfg_table_addr;
+
+    /* the erase unit size is a multiple of the record size, so records never straddle the units */
+    for(addr = ctx->cfg_table_addr; addr < ctx->cfg_table_addr + 2 * ctx->cfg_erase_unit; addr += ctx->rec_size)
+    {
+        r = (const slot_rec_t*)addr;
+        if(rec_valid(r) && (r->seq > ctx->seq))
+        {
+            ctx->seq = r->seq;
+            ctx->active = r->active;
+            last = addr;
+        }
+    }
+
+    if(ctx->seq)
+    {
+        ctx->next_addr = next_free(ctx, last);
+    }
+    ctx->boot = ctx->active;
+    return BL_SLOT_OK;
+}
+
+ /**
+ * @brief  choose the slot to start: the activated one, or the other one when it fails op_validate
+ * @param  ctx: bl_slot instance
+ * @retval slot index, -1 if neither slot holds a valid image
+ */
+int bl_slot_select(bl_slot_t *ctx)
+{
+    uint32_t i, slot;
+
+    for(i=0; i<BL_SLOT_NUM; i++)
+    {
+        slot = (ctx->active + i) % BL_SLOT_NUM;
+        if(ctx->op_validate(ctx->cfg_base[slot]) == 0)
+        {
+            ctx->boot = slot;
+            return slot;
+        }
+    }
+    ctx->boot = ctx->active;
+    return -1;
+}
+
+ /**
+ * @brief  base address for downloads, the slot bl_slot_select did not choose
+ * @param  ctx: bl_slot instance
+ * @retval slot base address
+ */
+uint32_t bl_slot_inactive(bl_slot_t *ctx)
+{
+    return ctx->cfg_base[(ctx->boot + 1) % BL_SLOT_NUM];
+}
+
+ /**
+ * @brief  make slot the one started from the next boot on
+ * @note   the image is validated first. The activation takes effect with a single record program:
+ *         before it completes the previous record is the current one
+ * @param  ctx: bl_slot instance
+ * @param  slot: slot index
+ * @retval BL_SLOT_OK or BL_SLOT_ERR_xxx
+ */
+int bl_slot_activate(bl_slot_t *ctx, uint32_t slot)
+{
+    slot_rec_t *r = (slot_rec_t*)ctx->rec;
+    uint32_t addr = ctx->next_addr;
+    int ret;
+
+    if(slot >= BL_SLOT_NUM)
+    {
+        return BL_SLOT_ERR_CFG;
+    }
+    if(ctx->op_validate(ctx->cfg_base[slot]))
+    {
+        return BL_SLOT_ERR_IMAGE;
+    }
+
+    /* entering a unit, the current record is in the other one */
+    if((((addr - ctx->cfg_table_addr) % ctx->cfg_erase_unit) == 0) && !is_blank(addr, ctx->cfg_erase_unit))
+    {
+        if(ctx->op_erase(addr))
+        {
+            return BL_SLOT_ERR_FLASH;
+        }
+    }
+
+    memset(ctx->rec, 0xFF, sizeof(ctx->rec));
+    r->magic = SLOT_MAGIC;
+    r->seq = ctx->seq + 1;
+    r->active = slot;
+    r->crc = rec_crc(r);
+
+    ret = ctx->op_program(addr, (const uint8_t*)ctx->rec, ctx->rec_size);
+    ctx->next_addr = next_free(ctx, addr);
+    if(ret || !rec_valid((const slot_rec_t*)addr))
+    {
+        return BL_SLOT_ERR_FLASH;
+    }
+
+    ctx->seq = r->seq;
+    ctx->active = slot;
+    ctx->boot = slot;
+    return BL_SLOT_OK;
+}
+
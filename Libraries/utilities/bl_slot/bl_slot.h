@@ -0,0 +1,66 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __BL_SLOT_H__
+#define __BL_SLOT_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* largest program unit of the table memory */
+#ifndef BL_SLOT_REC_SIZE
+#define BL_SLOT_REC_SIZE        (64)
+#endif
+
+#define BL_SLOT_NUM             (2)
+
+/* return code */
+#define BL_SLOT_OK              (0)
+#define BL_SLOT_ERR_IMAGE       (1)     /* slot image fails op_validate */
+#define BL_SLOT_ERR_FLASH       (2)
+#define BL_SLOT_ERR_CFG         (3)
+
+/* two execute-in-place image slots, each image is linked for its own slot. The slot table is a log of
+   activation records in two erase units: the record with the largest sequence number and a good CRC
+   is the current one, so a torn write or erase always leaves the previous activation in effect */
+typedef struct
+{
+    uint32_t cfg_base[BL_SLOT_NUM];
+    uint32_t cfg_table_addr;        /* 2 * cfg_erase_unit, outside both slots */
+    uint32_t cfg_erase_unit;
+    uint32_t cfg_program_unit;      /* <= BL_SLOT_REC_SIZE */
+
+    /* raw primitives of the table memory, return 0 on success */
+    int (*op_erase)(uint32_t addr);
+    int (*op_program)(uint32_t addr, const uint8_t *buf, uint32_t len);
+    int (*op_validate)(uint32_t base);      /* 0: the image at base may be started */
+
+    /* bl_slot private resource */
+    uint32_t rec[BL_SLOT_REC_SIZE/4];
+    uint32_t rec_size;
+    uint32_t seq;                   /* of the current record, 0: none */
+    uint32_t active;                /* activated slot */
+    uint32_t boot;                  /* slot chosen by bl_slot_select */
+    uint32_t next_addr;             /* where the next record goes */
+}bl_slot_t;
+
+
+int bl_slot_init(bl_slot_t *ctx);
+int bl_slot_select(bl_slot_t *ctx);
+uint32_t bl_slot_inactive(bl_slot_t *ctx);
+int bl_slot_activate(bl_slot_t *ctx, uint32_t slot);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
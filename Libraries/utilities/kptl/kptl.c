@@ -27,7 +27,7 @@
     @param  src:            current buffer pointer
     @param  lengthInBytes:  length of current buf
 */
-void crc16_update(uint16_t *currectCrc, const uint8_t *src, uint32_t lengthInBytes)
+KPTL_RAMFUNC void crc16_update(uint16_t *currectCrc, const uint8_t *src, uint32_t lengthInBytes)
 {
     uint32_t crc = *currectCrc;
     uint32_t j;
@@ -49,6 +49,27 @@ void crc16_update(uint16_t *currectCrc, const uint8_t *src, uint32_t lengthInByt
     *currectCrc = crc;
 }
 
+/* generate CRC32, IEEE 802.3 reflected, same result as zlib crc32
+    @param  currentCrc:     running value, a new start must refer a zero uint32_t
+    @param  src:            current buffer pointer
+    @param  lengthInBytes:  length of current buf
+*/
+void crc32_update(uint32_t *currentCrc, const uint8_t *src, uint32_t lengthInBytes)
+{
+    uint32_t crc = ~(*currentCrc);
+    uint32_t i, j;
+    
+    for (j=0; j < lengthInBytes; ++j)
+    {
+        crc ^= src[j];
+        for (i = 0; i < 8; ++i)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    *currentCrc = ~crc;
+}
+
 void kptl_create_ping(packet_ping_t *p)
 {
     p->start_byte = kFramingPacketStartByte;
@@ -81,6 +102,21 @@ void kptl_create_cmd_packet(frame_packet_t *fp, cmd_packet_t *cp, uint32_t *para
     kptl_frame_packet_final(fp);
 }
 
+void kptl_create_addressed_packet(frame_packet_t *fp, uint8_t node, uint8_t type, uint16_t seq, uint8_t *buf, uint16_t len)
+{
+    addr_hdr_t hdr;
+    
+    hdr.node = node;
+    hdr.type = type;
+    hdr.seq[0] = (seq >> 0) & 0xFF;
+    hdr.seq[1] = (seq >> 8) & 0xFF;
+    
+    kptl_frame_packet_begin(fp, kFramingPacketType_Addressed);
+    kptl_frame_packet_add(fp, (uint8_t*)&hdr, sizeof(hdr));
+    kptl_frame_packet_add(fp, buf, len);
+    kptl_frame_packet_final(fp);
+}
+
 uint32_t kptl_cmd_packet_get_size(cmd_packet_t *cp)
 {
     return 4 + cp->param_cnt*sizeof(uint32_t); 
@@ -222,7 +258,7 @@ int kptl_decode_init(pkt_dec_t *d)
     return 0;
 }
 
-#define SAFE_CALL_CB    if(d->cb) d->cb(p)
+#define SAFE_CALL_CB    if(d->cb) d->cb(p, d->user)
     
  /**
  * @brief  decode any type of packet
@@ -231,7 +267,7 @@ int kptl_decode_init(pkt_dec_t *d)
  * @retval CH_OK
  */
 
-uint32_t kptl_decode(pkt_dec_t *d, uint8_t c)
+KPTL_RAMFUNC uint32_t kptl_decode(pkt_dec_t *d, uint8_t c)
 {
     int ret = CH_ERR;
     uint16_t crc_calculated = 0;          /* CRC value caluated from a frame */
@@ -255,6 +291,7 @@ uint32_t kptl_decode(pkt_dec_t *d, uint8_t c)
                     d->status = kStatus_LenLow;
                     break;
                 case kFramingPacketType_Data:
+                case kFramingPacketType_Addressed:
                     d->status = kStatus_LenLow;
                     break;
                 case kFramingPacketType_Ping:
@@ -302,7 +339,7 @@ uint32_t kptl_decode(pkt_dec_t *d, uint8_t c)
         case kStatus_Data:
             payload_buf[d->cnt++] = c;
                    
-            if((p->hr.packet_type == kFramingPacketType_Command || p->hr.packet_type == kFramingPacketType_Data) && d->cnt >= ARRAY2INT16(p->len))
+            if((p->hr.packet_type == kFramingPacketType_Command || p->hr.packet_type == kFramingPacketType_Data || p->hr.packet_type == kFramingPacketType_Addressed) && d->cnt >= ARRAY2INT16(p->len))
             {
                 /* calculate CRC */
                 crc_calculated = 0;
@@ -18,6 +18,14 @@
 
 #define ARRAY2INT16(x)     (x[0] + (x[1] << 8))
 
+/* receive hot path placement, same switch as RAMFUNC in the drivers common.h. Only for speed: the
+   decoder calls back into code in flash, so it must not run while a flash command is in progress */
+#if defined(CHLIB_RAMFUNC_SUPPORT) && (CHLIB_RAMFUNC_SUPPORT == 1)
+#define KPTL_RAMFUNC       __attribute__((section("RamFunction")))
+#else
+#define KPTL_RAMFUNC
+#endif
+
 /* header include start_byte and type */
 typedef struct
 {
@@ -37,10 +45,22 @@ typedef struct
 {
     frame_packet_t*  fp;
     uint32_t         cnt;
-    void (*cb)(frame_packet_t *pkt);
+    void (*cb)(frame_packet_t *pkt, void *user);
+    void*            user;      /* passed to cb, lets several decoders share one callback */
     uint8_t          status;
 }pkt_dec_t;
 
+/* addressed frame: the payload of a kFramingPacketType_Addressed frame starts with this header,
+   followed by the command packet or the data of the inner frame */
+typedef struct
+{
+    uint8_t node;           /* destination node, KPTL_NODE_BROADCAST: all nodes */
+    uint8_t type;           /* inner frame type: command, data or ping */
+    uint8_t seq[2];         /* data: frame index within the WriteMemory transfer */
+}addr_hdr_t;
+
+#define KPTL_NODE_BROADCAST     (0xFF)
+
 /* ping packet, ack packet, nak packet are only contain 2 bytes */
 typedef packet_hr_t packet_ping_t;
 typedef packet_hr_t packet_ack_t;
@@ -77,7 +97,8 @@ enum
     kFramingPacketType_Command      = 0xA4,
     kFramingPacketType_Data         = 0xA5,
     kFramingPacketType_Ping         = 0xA6,
-    kFramingPacketType_PingResponse = 0xA7
+    kFramingPacketType_PingResponse = 0xA7,
+    kFramingPacketType_Addressed    = 0xA8,     /* multi-drop bus, see addr_hdr_t */
 };
 
 /* command tag */
@@ -105,6 +126,7 @@ enum
     kCommandTag_FlashReadResource           = 0x10,
     kCommandTag_FlashReadResourceResponse   = 0xb0,
     kCommandTag_ConfigureQuadSpi            = 0x11,
+    kCommandTag_MultidropStatus             = 0x20,     /* vendor: broadcast transfer status of one node */
 
     kFirstCommandTag                    = kCommandTag_FlashEraseAll,
 
@@ -134,10 +156,14 @@ void kptl_create_ack(packet_ack_t *p);
 void kptl_create_nak(packet_nak_t *p);
 void kptl_create_ping_resp_packet(ping_resp_packet_t *p, uint8_t major, uint8_t minor, uint8_t bugfix, uint8_t opt_low, uint8_t opt_high);
 
+/* addressed frame, wraps an inner frame for one node or all */
+void kptl_create_addressed_packet(frame_packet_t *fp, uint8_t node, uint8_t type, uint16_t seq, uint8_t *buf, uint16_t len);
+
 /* packet decode API */
 int kptl_decode_init(pkt_dec_t *d);
 uint32_t kptl_decode(pkt_dec_t *d, uint8_t c);
 void crc16_update(uint16_t *currectCrc, const uint8_t *src, uint32_t lengthInBytes);
+void crc32_update(uint32_t *currentCrc, const uint8_t *src, uint32_t lengthInBytes);
 
 #endif
 
@@ -8,23 +8,259 @@
 #include "mcuboot.h"
 #include <string.h>
 
-static int evt = 0;
+/* an asynchronous op_send may still read one of the tx buffers */
+static void tx_wait(mcuboot_t *ctx)
+{
+    if(ctx->op_send_is_busy)
+    {
+        while(ctx->op_send_is_busy());
+    }
+}
+
+/* nothing is sent while a broadcast is handled, every node would answer at once */
+static void tx_send(mcuboot_t *ctx, uint8_t *buf, uint32_t len)
+{
+#if (MCUBOOT_MULTIDROP == 1)
+    if(ctx->md_quiet)
+    {
+        return;
+    }
+#endif
+    ctx->op_send(buf, len);
+}
+
+static void send_ack(mcuboot_t *ctx)
+{
+    tx_wait(ctx);
+    kptl_create_ack(&ctx->tx_ack);
+    tx_send(ctx, (uint8_t*)&ctx->tx_ack, sizeof(ctx->tx_ack));
+}
+
+static void send_generic_resp(mcuboot_t *ctx, uint32_t status, uint32_t tag)
+{
+    tx_wait(ctx);
+    kptl_create_generic_resp_packet(&ctx->tx_pkt, status, tag);
+    tx_send(ctx, (uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
+}
+
+/* keep the first memory failure of the WriteMemory, it becomes the status of the final response */
+static void mem_latch(mcuboot_t *ctx, int ret)
+{
+    if((ret != 0) && (ctx->mem_err == 0))
+    {
+        ctx->mem_err = ret;
+    }
+}
+
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+/* sector of the flash region holding addr, -1 outside the region or the map */
+static int eod_sector(mcuboot_t *ctx, uint32_t addr)
+{
+    uint32_t idx;
+    
+    if((addr < ctx->cfg_flash_start) || ((addr - ctx->cfg_flash_start) >= ctx->cfg_flash_size))
+    {
+        return -1;
+    }
+    idx = (addr - ctx->cfg_flash_start) / ctx->cfg_flash_sector_size;
+    return (idx < MCUBOOT_EOD_MAX_SECTORS)?((int)idx):(-1);
+}
+
+/* erase the sector holding addr unless this session already did. Only a sector lying completely inside
+   the WriteMemory transfer is erased, the bytes around the transfer stay; sectors outside the map are left
+   to the host */
+static void eod_erase(mcuboot_t *ctx, uint32_t addr)
+{
+    int idx = eod_sector(ctx, addr);
+    uint32_t start;
+    
+    if((idx < 0) || (ctx->eod_map[idx >> 3] & (1 << (idx & 7))))
+    {
+        return;
+    }
+    start = ctx->cfg_flash_start + idx * ctx->cfg_flash_sector_size;
+    if((start < ctx->mem_start_addr) || ((start - ctx->mem_start_addr + ctx->cfg_flash_sector_size) > ctx->mem_len))
+    {
+        return;
+    }
+    if(ctx->op_mem_erase(start, ctx->cfg_flash_sector_size) == 0)
+    {
+        ctx->eod_map[idx >> 3] |= (1 << (idx & 7));
+    }
+}
+
+/* every sector touched by [addr, addr + len) before data goes there. Data for a sector the transfer only
+   partly covers must find it blank, the host erases such a sector. Returns non 0 when it is not blank */
+static int eod_enter(mcuboot_t *ctx, uint32_t addr, uint32_t len)
+{
+    uint32_t end = addr + len, next, lim, n, i;
+    uint8_t buf[16];
+    int idx;
+    
+    /* a transfer buffered by the memory layer leaves flash alone until it is complete */
+    if(ctx->eod_off)
+    {
+        return 0;
+    }
+    while(addr < end)
+    {
+        next = (addr - (addr - ctx->cfg_flash_start) % ctx->cfg_flash_sector_size) + ctx->cfg_flash_sector_size;
+        eod_erase(ctx, addr);
+        idx = eod_sector(ctx, addr);
+        if((idx >= 0) && !(ctx->eod_map[idx >> 3] & (1 << (idx & 7))) && ctx->op_mem_read)
+        {
+            lim = (end < next)?(end):(next);
+            for(; addr < lim; addr += n)
+            {
+                n = ((lim - addr) > sizeof(buf))?(sizeof(buf)):(lim - addr);
+                if(ctx->op_mem_read(addr, buf, n) != 0)
+                {
+                    return 1;
+                }
+                for(i=0; i<n; i++)
+                {
+                    if(buf[i] != 0xFF)
+                    {
+                        return 1;
+                    }
+                }
+            }
+        }
+        addr = next;
+    }
+    return 0;
+}
+
+/* an erase the host asked for counts as well, the data written after it is kept */
+static void eod_mark(mcuboot_t *ctx, uint32_t addr, uint32_t len)
+{
+    uint32_t end = addr + len;
+    int idx;
+    
+    while(addr < end)
+    {
+        idx = eod_sector(ctx, addr);
+        if(idx >= 0)
+        {
+            ctx->eod_map[idx >> 3] |= (1 << (idx & 7));
+        }
+        addr = (addr - (addr - ctx->cfg_flash_start) % ctx->cfg_flash_sector_size) + ctx->cfg_flash_sector_size;
+    }
+}
+#endif
+
+#if (MCUBOOT_MULTIDROP == 1)
+/* WriteMemory on a multi-drop bus: data frames carry their index and may arrive in any order */
+static int md_begin(mcuboot_t *ctx)
+{
+    ctx->md_frames = (ctx->mem_len + MCUBOOT_MD_CHUNK - 1) / MCUBOOT_MD_CHUNK;
+    ctx->md_rx_cnt = 0;
+    memset(ctx->md_map, 0, sizeof(ctx->md_map));
+    if(ctx->md_frames > MCUBOOT_MD_MAX_FRAMES)
+    {
+        ctx->md_frames = 0;
+        return 1;
+    }
+    return 0;
+}
+
+static void md_data(mcuboot_t *ctx, uint32_t seq, uint8_t *buf, uint32_t len)
+{
+    uint32_t off = seq * MCUBOOT_MD_CHUNK;
+    
+    /* a frame already programmed is skipped, the host may repeat it for another node */
+    if((seq >= ctx->md_frames) || (ctx->md_map[seq >> 3] & (1 << (seq & 7))) || (len > (ctx->mem_len - off)))
+    {
+        return;
+    }
+    
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+    if(eod_enter(ctx, ctx->mem_start_addr + off, len) != 0)
+    {
+        mem_latch(ctx, 1);
+    }
+    else
+#endif
+    {
+        mem_latch(ctx, ctx->op_mem_write(ctx->mem_start_addr + off, buf, len));
+    }
+    ctx->md_map[seq >> 3] |= (1 << (seq & 7));
+    ctx->md_rx_cnt++;
+    
+    if(ctx->md_rx_cnt == ctx->md_frames)
+    {
+        if(ctx->op_mem_flush)
+        {
+            mem_latch(ctx, ctx->op_mem_flush());
+        }
+        ctx->op_complete();
+    }
+}
+
+/* status of the broadcast transfer: frames received, first missing frame from first and a mask of
+   the 32 frames following it, CRC32 of the written region once complete */
+static uint8_t md_status(mcuboot_t *ctx, uint32_t first, uint32_t *param)
+{
+    uint8_t buf[32];
+    uint32_t seq, addr, n, crc = 0;
+    
+    for(seq = first; seq < ctx->md_frames; seq++)
+    {
+        if((ctx->md_map[seq >> 3] & (1 << (seq & 7))) == 0) break;
+    }
+    param[1] = ctx->md_rx_cnt;
+    param[2] = seq;
+    param[3] = 0;
+    for(n = 0; n < 32 && (seq + n) < ctx->md_frames; n++)
+    {
+        if((ctx->md_map[(seq + n) >> 3] & (1 << ((seq + n) & 7))) == 0)
+        {
+            param[3] |= (1U << n);
+        }
+    }
+    
+    if((ctx->md_frames != 0) && (ctx->md_rx_cnt == ctx->md_frames))
+    {
+        for(addr = ctx->mem_start_addr; addr < (ctx->mem_start_addr + ctx->mem_len); addr += n)
+        {
+            n = ctx->mem_start_addr + ctx->mem_len - addr;
+            n = (n > sizeof(buf))?(sizeof(buf)):(n);
+            ctx->op_mem_read(addr, buf, n);
+            crc32_update(&crc, buf, n);
+        }
+    }
+    param[4] = crc;
+    return 5;
+}
+
+ /**
+ * @brief  node id in 1..254 from the unique id, for buses without configured addresses
+ * @note   two nodes may get the same id, the host should check the uuid property of each node
+ * @param  uid: GetUID()
+ * @retval node id
+ */
+uint8_t mcuboot_node_id_from_uid(uint32_t uid)
+{
+    uid ^= (uid >> 16);
+    uid ^= (uid >> 8);
+    return (uid & 0xFF) % 254 + 1;
+}
+#endif
 
 static void handle_cmd(mcuboot_t *ctx, frame_packet_t *pkt)
 {
-    packet_ack_t ack;
     cmd_packet_t rx_cp;
     uint32_t tx_param[7];
     uint32_t rx_param[7];
     uint8_t tx_param_cnt = 0;
+    int ret;
    
     memcpy(&rx_cp, pkt->payload, 4);
     memcpy(rx_param, &pkt->payload[4], rx_cp.param_cnt*sizeof(uint32_t));
     rx_cp.param = rx_param;
     
     /* reply ack */
-    kptl_create_ack(&ack);
-    ctx->op_send((uint8_t*)&ack, sizeof(ack));
+    send_ack(ctx);
     
     switch(rx_cp.tag)
     {
@@ -92,41 +328,91 @@ static void handle_cmd(mcuboot_t *ctx, frame_packet_t *pkt)
                     tx_param_cnt = 2;
                     break;
                 default:
-                    /* not supported */
-                    //printf("command not supported\r\n");
+                    /* board specific properties, vendor tags from 0x80 */
+                    if(ctx->op_get_property)
+                    {
+                        tx_param_cnt = ctx->op_get_property(rx_cp.param[0], tx_param);
+                    }
                     break;
             }
             
+            tx_wait(ctx);
             kptl_create_property_resp_packet(&ctx->tx_pkt, tx_param_cnt, tx_param);
-            ctx->op_send((uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
+            tx_send(ctx, (uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
             break;
         case kCommandTag_FlashEraseRegion:
             ctx->mem_start_addr = rx_cp.param[0];
             ctx->mem_len = rx_cp.param[1];
-            ctx->op_mem_erase(ctx->mem_start_addr, ctx->mem_len);
-            kptl_create_generic_resp_packet(&ctx->tx_pkt, 0, kCommandTag_FlashEraseRegion);
-            ctx->op_send((uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
+            ret = ctx->op_mem_erase(ctx->mem_start_addr, ctx->mem_len);
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+            if(ret == 0)
+            {
+                eod_mark(ctx, ctx->mem_start_addr, ctx->mem_len);
+            }
+#endif
+            send_generic_resp(ctx, (ret == 0)?(0):(1), kCommandTag_FlashEraseRegion);
             break;
-        case kCommandTag_FlashEraseAll: /* not support */
-            kptl_create_generic_resp_packet(&ctx->tx_pkt, 0, kCommandTag_FlashEraseAll);
-            ctx->op_send((uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
+        case kCommandTag_FlashEraseAll: /* erase the application region, the bootloader is outside it */
+            ret = ctx->op_mem_erase(ctx->cfg_flash_start, ctx->cfg_flash_size);
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+            if(ret == 0)
+            {
+                eod_mark(ctx, ctx->cfg_flash_start, ctx->cfg_flash_size);
+            }
+#endif
+            send_generic_resp(ctx, (ret == 0)?(0):(1), kCommandTag_FlashEraseAll);
             break;
         case kCommandTag_WriteMemory:
             ctx->mem_start_addr = rx_cp.param[0];
             ctx->mem_len = rx_cp.param[1];
             ctx->mem_cur_addr = ctx->mem_start_addr;
-
-            kptl_create_generic_resp_packet(&ctx->tx_pkt, 0x00000000, kCommandTag_WriteMemory);
-            ctx->op_send((uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
+            ctx->mem_err = 0;
+            ret = 0;
+            if(ctx->op_mem_begin)
+            {
+                ret = ctx->op_mem_begin(ctx->mem_start_addr, ctx->mem_len);
+            }
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+            ctx->eod_off = (ret != 0);
+#endif
+#if (MCUBOOT_MULTIDROP == 1)
+            if(ctx->cfg_node_id)
+            {
+                send_generic_resp(ctx, md_begin(ctx), kCommandTag_WriteMemory);
+                break;
+            }
+#endif
+            send_generic_resp(ctx, 0x00000000, kCommandTag_WriteMemory);
+            break;
+#if (MCUBOOT_MULTIDROP == 1)
+        case kCommandTag_MultidropStatus:
+            if(ctx->op_mem_flush)
+            {
+                mem_latch(ctx, ctx->op_mem_flush());
+            }
+            tx_param[0] = (ctx->mem_err == 0)?(0):(1);
+            tx_param_cnt = md_status(ctx, (rx_cp.param_cnt)?(rx_cp.param[0]):(0), tx_param);
+            tx_wait(ctx);
+            kptl_create_property_resp_packet(&ctx->tx_pkt, tx_param_cnt, tx_param);
+            tx_send(ctx, (uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
             break;
+#endif
         case kCommandTag_Reset:
-            kptl_create_generic_resp_packet(&ctx->tx_pkt, 0x00000000, kCommandTag_Reset);
-            ctx->op_send((uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
+            send_generic_resp(ctx, 0x00000000, kCommandTag_Reset);
+            tx_wait(ctx);
             ctx->op_reset();
             break;
+        case kCommandTag_Call:
+            /* host code in RAM, typically a flash loader, answers when it returns */
+            tx_param[0] = 1;
+            if(ctx->op_call)
+            {
+                tx_param[0] = ctx->op_call(rx_cp.param[0], (rx_cp.param_cnt > 1)?(rx_cp.param[1]):(0));
+            }
+            send_generic_resp(ctx, tx_param[0], kCommandTag_Call);
+            break;
         case kCommandTag_Execute:
-            kptl_create_generic_resp_packet(&ctx->tx_pkt, 0x00000000, kCommandTag_Execute);
-            ctx->op_send((uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
+            send_generic_resp(ctx, 0x00000000, kCommandTag_Execute);
         
             uint32_t addr, arg, sp;
         
@@ -134,6 +420,7 @@ static void handle_cmd(mcuboot_t *ctx, frame_packet_t *pkt)
             arg = rx_cp.param[1];
             sp = rx_cp.param[2];
         
+            tx_wait(ctx);
             ctx->op_jump(addr, arg, sp);
             break;
         default:
@@ -142,9 +429,15 @@ static void handle_cmd(mcuboot_t *ctx, frame_packet_t *pkt)
     }
 }
 
-static void dec_cb(frame_packet_t *rx)
+/* user is the mcuboot_t owning the decoder, one frame is pending until mcuboot_proc handled it.
+   The host acks our responses, there is nothing to handle for an ACK or NAK */
+static void dec_cb(frame_packet_t *rx, void *user)
 {
-    evt = 1;
+    if((rx->hr.packet_type == kFramingPacketType_Ack) || (rx->hr.packet_type == kFramingPacketType_Nak))
+    {
+        return;
+    }
+    ((mcuboot_t*)user)->evt = 1;
 }
 
 uint32_t mcuboot_is_connected(mcuboot_t *ctx)
@@ -152,79 +445,193 @@ uint32_t mcuboot_is_connected(mcuboot_t *ctx)
     return ctx->is_connected;
 }
 
-void mcuboot_proc(mcuboot_t *ctx)
+/* the host waits for the answer to its first frame, the line is quiet while op_connect runs */
+static void set_connected(mcuboot_t *ctx)
 {
-    if(evt)
+    if(!ctx->is_connected)
     {
         ctx->is_connected = 1;
-        switch(ctx->rx_pkt.hr.packet_type)
+        if(ctx->op_connect)
+        {
+            ctx->op_connect();
+        }
+    }
+}
+
+/* handle the received frame */
+static void dispatch(mcuboot_t *ctx)
+{
+    switch(ctx->rx_pkt.hr.packet_type)
+    {
+        case kFramingPacketType_Ping:
+        {
+            tx_wait(ctx);
+            kptl_create_ping_resp_packet(&ctx->tx_ping, 1, 2, 0, 0, 0);
+            tx_send(ctx, (uint8_t*)&ctx->tx_ping, sizeof(ping_resp_packet_t));
+            break;
+        }
+        case kFramingPacketType_Command:
         {
-            case kFramingPacketType_Ping:
+            handle_cmd(ctx, &ctx->rx_pkt);
+            break;
+        }
+
+        case kFramingPacketType_Data:
+        {
+            int len;
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+            uint32_t ahead;
+#endif
+            len = ARRAY2INT16(ctx->rx_pkt.len);
+            
+            /* host sends next packet while this one is programmed, rx_pkt is only reused after we return */
+            if(ctx->cfg_ack_before_write)
             {
-                ping_resp_packet_t pr;
-                kptl_create_ping_resp_packet(&pr, 1, 2, 0, 0, 0);
-                ctx->op_send((uint8_t*)&pr, sizeof(ping_resp_packet_t));
-                break;
+                send_ack(ctx);
             }
-            case kFramingPacketType_Command:
+            
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+            /* normally erased ahead by the previous packet */
+            if(eod_enter(ctx, ctx->mem_cur_addr, len) != 0)
             {
-                handle_cmd(ctx, &ctx->rx_pkt);
-                break;
+                mem_latch(ctx, 1);
             }
-
-            case kFramingPacketType_Data:
+            else
+#endif
             {
-                packet_ack_t ack;
-    
-                int len;
-                len = ARRAY2INT16(ctx->rx_pkt.len);
-                
-                ctx->op_mem_write(ctx->mem_cur_addr, ctx->rx_pkt.payload, len);
-                ctx->mem_cur_addr += len;
-                
-                /* reply ack */
-                kptl_create_ack(&ack);
-                ctx->op_send((uint8_t*)&ack, sizeof(ack));
-                
-                /* send final generic resp packet */
-                
-                if(ctx->mem_cur_addr >= (ctx->mem_start_addr + ctx->mem_len))
+                mem_latch(ctx, ctx->op_mem_write(ctx->mem_cur_addr, ctx->rx_pkt.payload, len));
+            }
+            ctx->mem_cur_addr += len;
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+            /* the sector after the cursor is erased now, with cfg_ack_before_write while the host
+               already sends the next packet */
+            if(!ctx->eod_off && (eod_sector(ctx, ctx->mem_cur_addr) >= 0))
+            {
+                ahead = ctx->mem_cur_addr - (ctx->mem_cur_addr - ctx->cfg_flash_start) % ctx->cfg_flash_sector_size + ctx->cfg_flash_sector_size;
+                if(ahead < ctx->mem_start_addr + ctx->mem_len)
                 {
-                    kptl_create_generic_resp_packet(&ctx->tx_pkt, 0x00000000, kCommandTag_WriteMemory);
-                    ctx->op_send((uint8_t*)&ctx->tx_pkt, kptl_frame_packet_get_size(&ctx->tx_pkt));
-                    
-                    /* callback: complete */
-                    ctx->op_complete();
+                    eod_erase(ctx, ahead);
                 }
-                break;
             }
-            case kFramingPacketType_Ack:
-                break;
-            case kFramingPacketType_Nak:
-                break;
-            default:
-                break;
+#endif
+            
+            /* reply ack */
+            if(!ctx->cfg_ack_before_write)
+            {
+                send_ack(ctx);
+            }
+            
+            /* send final generic resp packet */
+            
+            if(ctx->mem_cur_addr >= (ctx->mem_start_addr + ctx->mem_len))
+            {
+                /* program data still buffered by the memory layer, any failure fails the transfer */
+                if(ctx->op_mem_flush)
+                {
+                    mem_latch(ctx, ctx->op_mem_flush());
+                }
+                
+                send_generic_resp(ctx, (ctx->mem_err == 0)?(0):(1), kCommandTag_WriteMemory);
+                
+                /* callback: complete */
+                ctx->op_complete();
+            }
+            break;
+        }
+        case kFramingPacketType_Ack:
+            break;
+        case kFramingPacketType_Nak:
+            break;
+        default:
+            break;
+    }
+}
+
+#if (MCUBOOT_MULTIDROP == 1)
+/* multi-drop bus: plain frames, frames for other nodes and our own echoed responses are dropped,
+   an addressed command is unwrapped and handled like a plain one */
+static void md_proc(mcuboot_t *ctx)
+{
+    addr_hdr_t hdr;
+    uint32_t len = ARRAY2INT16(ctx->rx_pkt.len);
+    
+    if((ctx->rx_pkt.hr.packet_type != kFramingPacketType_Addressed) || (len < sizeof(hdr)))
+    {
+        return;
+    }
+    memcpy(&hdr, ctx->rx_pkt.payload, sizeof(hdr));
+    if((hdr.node != ctx->cfg_node_id) && (hdr.node != KPTL_NODE_BROADCAST))
+    {
+        return;
+    }
+    
+    set_connected(ctx);
+    len -= sizeof(hdr);
+    if(hdr.type == kFramingPacketType_Data)
+    {
+        md_data(ctx, ARRAY2INT16(hdr.seq), ctx->rx_pkt.payload + sizeof(hdr), len);
+        return;
+    }
+    
+    memmove(ctx->rx_pkt.payload, ctx->rx_pkt.payload + sizeof(hdr), len);
+    ctx->rx_pkt.len[0] = (len >> 0) & 0xFF;
+    ctx->rx_pkt.len[1] = (len >> 8) & 0xFF;
+    ctx->rx_pkt.hr.packet_type = hdr.type;
+    ctx->md_quiet = (hdr.node == KPTL_NODE_BROADCAST);
+    dispatch(ctx);
+    ctx->md_quiet = 0;
+}
+#endif
+
+void mcuboot_proc(mcuboot_t *ctx)
+{
+    if(ctx->evt)
+    {
+#if (MCUBOOT_MULTIDROP == 1)
+        if(ctx->cfg_node_id)
+        {
+            md_proc(ctx);
+            ctx->evt = 0;
+            return;
         }
-        evt = 0;
+#endif
+        set_connected(ctx);
+        dispatch(ctx);
+        ctx->evt = 0;
     }
 }
 
-void mcuboot_recv(mcuboot_t *ctx, uint8_t *buf, uint32_t len)
+ /**
+ * @brief  hand received bytes to the decoder
+ * @note   decoding stops right after a complete frame: the frame is held in rx_pkt until
+ *         mcuboot_proc has handled it, so the next frame must not be decoded over it. The caller
+ *         keeps the bytes that were not taken and passes them again after mcuboot_proc
+ * @param  ctx: mcuboot instance
+ * @param  buf: received bytes, a chunk may end or start anywhere in a frame
+ * @param  len: number of bytes
+ * @retval number of bytes taken, 0 while a frame is pending
+ */
+uint32_t mcuboot_recv(mcuboot_t *ctx, uint8_t *buf, uint32_t len)
 {
-    int i;
+    uint32_t i;
     
-    for(i=0; i<len; i++)
+    for(i=0; (i<len) && !ctx->evt; i++)
     {
         kptl_decode(&ctx->dec, buf[i]);
     }
+    return i;
 }
 
 void mcuboot_init(mcuboot_t *ctx)
 {
     ctx->dec.fp = &ctx->rx_pkt;
     ctx->dec.cb = dec_cb;
+    ctx->dec.user = ctx;
     kptl_decode_init(&ctx->dec);
     ctx->is_connected = 0;
-    evt = 0;
+    ctx->evt = 0;
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+    memset(ctx->eod_map, 0, sizeof(ctx->eod_map));
+#endif
 }
 
@@ -14,6 +14,32 @@
 
 #include "kptl.h"
 
+/* multi-drop bus: addressed frames, broadcast WriteMemory and per node status polling */
+#ifndef MCUBOOT_MULTIDROP
+#define MCUBOOT_MULTIDROP           (0)
+#endif
+
+/* largest broadcast transfer in data frames, costs MCUBOOT_MD_MAX_FRAMES/8 bytes of RAM */
+#ifndef MCUBOOT_MD_MAX_FRAMES
+#define MCUBOOT_MD_MAX_FRAMES       (4096)
+#endif
+
+/* erase on demand: WriteMemory erases each flash sector when the write cursor reaches it and the next one
+   ahead, so the host may skip FlashEraseRegion. A sector is erased at most once per session, and only if the
+   transfer covers it completely: the first and last sector of an unaligned transfer are left to the host */
+#ifndef MCUBOOT_ERASE_ON_DEMAND
+#define MCUBOOT_ERASE_ON_DEMAND     (0)
+#endif
+
+/* sectors of the flash region tracked by erase on demand, costs MCUBOOT_EOD_MAX_SECTORS/8 bytes of RAM */
+#ifndef MCUBOOT_EOD_MAX_SECTORS
+#define MCUBOOT_EOD_MAX_SECTORS     (512)
+#endif
+
+/* data bytes of one addressed data frame, frame n goes to start + n * MCUBOOT_MD_CHUNK; a
+   multiple of 8 so frames received out of order never share a program unit */
+#define MCUBOOT_MD_CHUNK            ((MAX_PACKET_LEN - sizeof(addr_hdr_t)) & ~7)
+
 typedef struct
 {
     /* packet handing resource */
@@ -21,9 +47,12 @@ typedef struct
     frame_packet_t rx_pkt;
 	  uint8_t reservedtx[2];//To make sure payload array in frame_packet is 4bytes aligned
     frame_packet_t tx_pkt;   
+    packet_ack_t tx_ack;
+    ping_resp_packet_t tx_ping;
    	pkt_dec_t dec;
-    /* transmit callback */
+    /* transmit callback, buf stays untouched until op_send_is_busy returns 0 */
     int (*op_send)(uint8_t* buf, uint32_t len);
+    int (*op_send_is_busy)(void);   /* optional, NULL: op_send returns when buf has been sent */
     
     /* configuartion */
     uint32_t cfg_flash_start;
@@ -33,27 +62,51 @@ typedef struct
     uint32_t cfg_ram_size;
     uint32_t cfg_device_id;
     uint32_t cfg_uuid;
+    uint32_t cfg_ack_before_write;  /* 1: ack data packet before op_mem_write, board must keep receiving during flash operations */
+#if (MCUBOOT_MULTIDROP == 1)
+    uint32_t cfg_node_id;           /* 1..254: only addressed frames for this node or broadcast are handled, 0: point to point */
+#endif
     
     /* memory operation */
-    int (*op_mem_write)(uint32_t addr, uint8_t* buf, uint32_t len);
+    int (*op_mem_write)(uint32_t addr, uint8_t* buf, uint32_t len);    /* non 0 fails the WriteMemory, the data packets are still acked */
     int (*op_mem_erase)(uint32_t addr, uint32_t len);
     int (*op_mem_read)(uint32_t addr, uint8_t* buf, uint32_t len);
+    int (*op_mem_flush)(void);  /* optional, called when a WriteMemory transfer is complete, non 0 fails it */
+    int (*op_mem_begin)(uint32_t addr, uint32_t len);      /* optional, called on WriteMemory before its first data packet, non 0:
+                                                               the transfer is buffered and programmed on op_mem_flush */
+    uint8_t (*op_get_property)(uint32_t tag, uint32_t *param);  /* optional, tags mcuboot does not know: fill param[1..], return the
+                                                                   count including the status in param[0], 0: not supported */
     void(*op_reset)(void);
     void(*op_jump)(uint32_t addr, uint32_t arg, uint32_t sp);
     void(*op_complete)(void);
+    void(*op_connect)(void);    /* optional, called on the first frame from a host before it is answered */
+    uint32_t(*op_call)(uint32_t addr, uint32_t arg);   /* optional, Call: run host code, returns the status of the response */
     
-    /* mcu boot private resource */
+    /* mcu boot private resource, all state lives here so several instances can run side by side */
+    volatile uint32_t evt;
     uint32_t mem_start_addr;
     uint32_t mem_len;
     uint32_t mem_cur_addr;
+    uint32_t mem_err;               /* first failure of op_mem_write or op_mem_flush in the current WriteMemory */
     uint32_t is_connected;
+#if (MCUBOOT_MULTIDROP == 1)
+    uint32_t md_quiet;              /* a broadcast is handled, nothing is sent */
+    uint32_t md_frames;             /* data frames of the current WriteMemory */
+    uint32_t md_rx_cnt;
+    uint8_t md_map[MCUBOOT_MD_MAX_FRAMES/8];   /* received data frames */
+#endif
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+    uint8_t eod_map[MCUBOOT_EOD_MAX_SECTORS/8]; /* sectors erased in this session */
+    uint32_t eod_off;               /* the current WriteMemory is buffered, nothing is erased on demand */
+#endif
 }mcuboot_t;
 
 
 void mcuboot_init(mcuboot_t *ctx);
-void mcuboot_recv(mcuboot_t *ctx, uint8_t *buf, uint32_t len);
+uint32_t mcuboot_recv(mcuboot_t *ctx, uint8_t *buf, uint32_t len);
 void mcuboot_proc(mcuboot_t *ctx);
 uint32_t mcuboot_is_connected(mcuboot_t *ctx);
+uint8_t mcuboot_node_id_from_uid(uint32_t uid);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "mflash.h"
+#include <string.h>
+
+#define MFLASH_ALIGN_DOWN(x, a)     ((x) & ~((a) - 1))
+#define MFLASH_ALIGN_UP(x, a)       (((x) + (a) - 1) & ~((a) - 1))
+
+static void mflash_read(mflash_t *ctx, uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    if(ctx->op_read)
+    {
+        ctx->op_read(addr, buf, len);
+    }
+    else
+    {
+        memcpy(buf, (void*)(uintptr_t)addr, len);
+    }
+}
+
+static int in_region(mflash_t *ctx, uint32_t addr, uint32_t len)
+{
+    return (addr >= ctx->cfg_start) && (len <= ctx->cfg_size) && ((addr - ctx->cfg_start) <= (ctx->cfg_size - len));
+}
+
+static int is_blank_buf(const uint8_t *buf, uint32_t len)
+{
+    while(len--)
+    {
+        if(*buf++ != 0xFF) return 0;
+    }
+    return 1;
+}
+
+/* len must be a multiple of 4 */
+static int is_blank(mflash_t *ctx, uint32_t addr, uint32_t len)
+{
+    uint32_t buf[8];
+    uint32_t i, n;
+
+    while(len)
+    {
+        n = (len > sizeof(buf))?(sizeof(buf)):(len);
+        mflash_read(ctx, addr, (uint8_t*)buf, n);
+        for(i=0; i<n/4; i++)
+        {
+            if(buf[i] != 0xFFFFFFFF) return 0;
+        }
+        addr += n;
+        len -= n;
+    }
+    return 1;
+}
+
+/* program whole units: all 0xFF units are skipped, the others are batched into one op_program per run */
+static int program_units(mflash_t *ctx, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    uint32_t pu = ctx->cfg_program_unit;
+    uint32_t run = 0;
+    uint32_t i;
+
+    for(i=0; i<=len; i+=pu)
+    {
+        if(i < len && !is_blank_buf(buf + i, pu))
+        {
+            run += pu;
+            continue;
+        }
+
+        if(run)
+        {
+            if(ctx->op_program(addr + i - run, buf + i - run, run)) return MFLASH_ERR_PROGRAM;
+            run = 0;
+        }
+    }
+    return MFLASH_OK;
+}
+
+ /**
+ * @brief  reset the engine, geometry and primitives must be filled before
+ * @param  ctx: mflash instance
+ * @retval None
+ */
+void mflash_init(mflash_t *ctx)
+{
+    ctx->stage_addr = 0;
+    ctx->stage_valid = 0;
+}
+
+ /**
+ * @brief  write the partial program unit kept in the stage buffer
+ * @note   missing bytes are filled with the current flash content
+ * @param  ctx: mflash instance
+ * @retval MFLASH_OK or error code
+ */
+int mflash_flush(mflash_t *ctx)
+{
+    int ret = MFLASH_OK;
+
+    if(ctx->stage_valid)
+    {
+        ret = program_units(ctx, ctx->stage_addr, (uint8_t*)ctx->stage, ctx->cfg_program_unit);
+        ctx->stage_valid = 0;
+    }
+    return ret;
+}
+
+ /**
+ * @brief  erase all erase units touched by [addr, addr + len)
+ * @note   units which are already blank are not erased again, blocks fully inside
+ *         the range are erased with op_erase_block
+ * @param  ctx: mflash instance
+ * @param  addr: start address, no alignment required
+ * @param  len: length in bytes
+ * @retval MFLASH_OK or error code
+ */
+int mflash_erase(mflash_t *ctx, uint32_t addr, uint32_t len)
+{
+    uint32_t eu = ctx->cfg_erase_unit;
+    uint32_t end;
+    int ret;
+
+    end = MFLASH_ALIGN_UP(addr + len, eu);
+    addr = MFLASH_ALIGN_DOWN(addr, eu);
+    if(!in_region(ctx, addr, end - addr)) return MFLASH_ERR_RANGE;
+
+    /* pending data inside the erased range is dropped, outside it stays staged: an erase ahead of
+       the writes must not close the unit they are still filling */
+    if(ctx->stage_valid && ctx->stage_addr >= addr && ctx->stage_addr < end)
+    {
+        ctx->stage_valid = 0;
+    }
+    ret = MFLASH_OK;
+
+    while((addr < end) && (ret == MFLASH_OK))
+    {
+        /* whole block inside the range: one block erase, falls back to sectors if it fails */
+        if(ctx->op_erase_block && ctx->cfg_block_size && ((addr & (ctx->cfg_block_size - 1)) == 0) && ((end - addr) >= ctx->cfg_block_size))
+        {
+            if(is_blank(ctx, addr, ctx->cfg_block_size) || (ctx->op_erase_block(addr) == 0))
+            {
+                addr += ctx->cfg_block_size;
+                continue;
+            }
+        }
+
+        if(!is_blank(ctx, addr, eu) && ctx->op_erase(addr))
+        {
+            ret = MFLASH_ERR_ERASE;
+        }
+        addr += eu;
+    }
+    return ret;
+}
+
+ /**
+ * @brief  write any length to any address in the region
+ * @note   aligned whole units go to op_program directly from buf, head and tail are merged
+ *         in the stage buffer; a partial tail is kept until the next write continues it or
+ *         mflash_flush is called
+ * @param  ctx: mflash instance
+ * @param  addr: start address
+ * @param  buf: data
+ * @param  len: length in bytes
+ * @retval MFLASH_OK or error code
+ */
+int mflash_write(mflash_t *ctx, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    uint32_t pu = ctx->cfg_program_unit;
+    uint32_t unit, off, n;
+    int ret;
+
+    if(!in_region(ctx, addr, len)) return MFLASH_ERR_RANGE;
+
+    while(len)
+    {
+        off = addr & (pu - 1);
+        unit = addr - off;
+
+        /* pending unit is not continued by this write */
+        if(ctx->stage_valid && ctx->stage_addr != unit)
+        {
+            ret = mflash_flush(ctx);
+            if(ret) return ret;
+        }
+
+        if(!ctx->stage_valid && (off == 0) && (len >= pu) && (((uintptr_t)buf & 3) == 0))
+        {
+            n = MFLASH_ALIGN_DOWN(len, pu);
+            ret = program_units(ctx, addr, buf, n);
+        }
+        else
+        {
+            if(!ctx->stage_valid)
+            {
+                mflash_read(ctx, unit, (uint8_t*)ctx->stage, pu);
+                ctx->stage_addr = unit;
+                ctx->stage_valid = 1;
+            }
+            n = (len < (pu - off))?(len):(pu - off);
+            memcpy((uint8_t*)ctx->stage + off, buf, n);
+
+            /* unit complete */
+            ret = ((off + n) == pu)?(mflash_flush(ctx)):(MFLASH_OK);
+        }
+
+        if(ret) return ret;
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+    return MFLASH_OK;
+}
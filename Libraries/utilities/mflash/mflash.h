@@ -0,0 +1,63 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __MFLASH_H__
+#define __MFLASH_H__
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* largest program unit the stage buffer can merge, LPC pages are 64 bytes */
+#ifndef MFLASH_STAGE_SIZE
+#define MFLASH_STAGE_SIZE       (64)
+#endif
+
+/* return code */
+#define MFLASH_OK               (0)
+#define MFLASH_ERR_RANGE        (1)
+#define MFLASH_ERR_ERASE        (2)
+#define MFLASH_ERR_PROGRAM      (3)
+
+typedef struct
+{
+    /* geometry, units must be power of 2 */
+    uint32_t cfg_start;             /* managed region, must not contain the bootloader: erase and write outside it are refused */
+    uint32_t cfg_size;
+    uint32_t cfg_erase_unit;        /* smallest erasable unit: sector or page */
+    uint32_t cfg_program_unit;      /* smallest programmable unit, <= MFLASH_STAGE_SIZE */
+    uint32_t cfg_erase_time_us;     /* typical time of one erase unit */
+    uint32_t cfg_program_time_us;   /* typical time of one program unit */
+    uint32_t cfg_block_size;        /* optional, 0: no block erase */
+
+    /* raw primitives, addresses are always aligned to the unit, return 0 on success */
+    int (*op_erase)(uint32_t addr);
+    int (*op_program)(uint32_t addr, const uint8_t *buf, uint32_t len);    /* len is n * program unit, buf 4 bytes aligned */
+    int (*op_read)(uint32_t addr, uint8_t *buf, uint32_t len);             /* optional, NULL: flash is memory mapped */
+    int (*op_erase_block)(uint32_t addr);                                   /* optional, only used on blocks fully inside the region */
+
+    /* mflash private resource */
+    uint32_t stage[MFLASH_STAGE_SIZE/4];
+    uint32_t stage_addr;
+    uint32_t stage_valid;
+}mflash_t;
+
+
+void mflash_init(mflash_t *ctx);
+int mflash_erase(mflash_t *ctx, uint32_t addr, uint32_t len);
+int mflash_write(mflash_t *ctx, uint32_t addr, const uint8_t *buf, uint32_t len);
+int mflash_flush(mflash_t *ctx);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
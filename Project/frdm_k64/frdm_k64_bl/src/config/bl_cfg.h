@@ -9,9 +9,115 @@
 #define __BL_CFG_H__
 
 
+/* 1: application lives in program flash block 1, flash operations then run while code runs from block 0 */
+#define BL_DUAL_BLOCK_RWW           (0)
+
 /* Base address of user application */
+#if (BL_DUAL_BLOCK_RWW == 1)
+#define APPLICATION_BASE            (0x80000UL)
+#else
 #define APPLICATION_BASE            (0x8000UL)
+#endif
 #define BL_TIMEOUT_MS               (300)
-#define TARGET_FLASH_SIZE           (512*1024)
 
+/* 1: RTS/CTS on PTB2/PTB3, the host may stream data packets without waiting for the flash */
+#define BL_UART_FLOW_CONTROL        (0)
+/* physical flash size, the application region runs from APPLICATION_BASE up to its end */
+#define TARGET_FLASH_SIZE           (1024*1024)
+
+/* 1: jump to a valid application at once, the listen window only opens on a mailbox request */
+#ifndef BL_FAST_BOOT
+#define BL_FAST_BOOT                (0)
+#endif
+
+/* 1: start only an image whose bl_image header (length, CRC32) matches, pc_tool/image_patch fills it in */
+#ifndef BL_IMAGE_CHECK
+#define BL_IMAGE_CHECK              (0)
+#endif
+
+/* the check result is cached in the last sector of the flash, the application region ends below it */
+#if (BL_IMAGE_CHECK == 1)
+#define BL_IMAGE_CACHE_SIZE         (4096)
+#else
+#define BL_IMAGE_CACHE_SIZE         (0)
+#endif
+
+/* 1: two image slots, one in each program flash block. Downloads go to the slot that is not running,
+   Execute at its base activates it, see bl_slot.h. Each image is linked for its own slot */
+#ifndef BL_AB_SLOTS
+#define BL_AB_SLOTS                 (0)
+#endif
+
+/* 1: program flash swap. Downloads are staged in block 1 at the addresses the image is linked for plus
+   BL_SWAP_BLOCK_SIZE, the host's Reset or Execute swaps the blocks. Exclusive with BL_AB_SLOTS */
+#ifndef BL_FLASH_SWAP
+#define BL_FLASH_SWAP               (0)
+#endif
+
+#if (BL_FLASH_SWAP == 1)
+#if (BL_IMAGE_CHECK == 0) || (BL_DUAL_BLOCK_RWW == 1) || (BL_AB_SLOTS == 1)
+#error "BL_FLASH_SWAP needs BL_IMAGE_CHECK to reject incomplete images, and uses block 1 itself"
+#endif
+#define BL_SWAP_BLOCK_SIZE          (0x80000UL)
+/* last sector of block 0 and its twin in block 1 are owned by the swap system */
+#define BL_SWAP_INDICATOR_ADDR      (0x7F000UL)
+#endif
+
+#if (BL_AB_SLOTS == 1)
+#if (BL_IMAGE_CHECK == 0) || (BL_DUAL_BLOCK_RWW == 1)
+#error "BL_AB_SLOTS needs BL_IMAGE_CHECK to reject incomplete slots, and lays out block 1 itself"
+#endif
+#define BL_SLOT_A_BASE              (APPLICATION_BASE)
+#define BL_SLOT_B_BASE              (0x80000UL)
+#define BL_SLOT_SIZE                (0x80000UL - APPLICATION_BASE)
+/* slot table, two sectors at the end of block 1, the verdict cache right below */
+#define BL_SLOT_TABLE_ADDR          (0xFE000UL)
+#define BL_IMAGE_CACHE_ADDR         (BL_SLOT_TABLE_ADDR - BL_IMAGE_CACHE_SIZE)
+#elif (BL_FLASH_SWAP == 1)
+#define BL_IMAGE_CACHE_ADDR         (BL_SWAP_INDICATOR_ADDR - BL_IMAGE_CACHE_SIZE)
+#else
+#define BL_IMAGE_CACHE_ADDR         (TARGET_FLASH_SIZE - BL_IMAGE_CACHE_SIZE)
+#endif
+
+/* 1: keep a progress journal of WriteMemory in flash, GetProperty 0x80 tells the host where to resume */
+#ifndef BL_JOURNAL
+#define BL_JOURNAL                  (0)
+#endif
+
+/* the journal sector sits right below the verdict cache, the application region shrinks by it */
+#if (BL_JOURNAL == 1)
+#define BL_JOURNAL_SIZE             (4096)
+#else
+#define BL_JOURNAL_SIZE             (0)
+#endif
+#define BL_JOURNAL_ADDR             (BL_IMAGE_CACHE_ADDR - BL_JOURNAL_SIZE)
+
+/* 1: run at MCG PEE 120MHz from the first host frame on, the reset clocks are restored before the jump */
+#ifndef BL_CLOCK_PROFILE
+#define BL_CLOCK_PROFILE            (0)
+#endif
+
+/* 1: receive a WriteMemory of up to BL_RAM_BURST_SIZE into SRAM first, then program it in one go with
+   PGMSEC. The host erases the range beforehand, a destination that is not blank is refused. Larger
+   transfers are programmed packet by packet */
+#ifndef BL_RAM_BURST
+#define BL_RAM_BURST                (0)
+#endif
+
+/* receive buffer, taken from the bootloader IRAM */
+#if (BL_RAM_BURST == 1)
+#define BL_RAM_BURST_SIZE           (128*1024)
+#endif
+
+/* 1: run a host supplied flash loader with Call, see bl_loader.h. The blob goes to SRAM_L, which the
+   bootloader does not link into, and GetProperty reports it as the RAM */
+#ifndef BL_RAM_LOADER
+#define BL_RAM_LOADER               (0)
+#endif
+
+#define BL_LOADER_RAM_START         (0x1FFF0000UL)
+#define BL_LOADER_RAM_SIZE          (0x10000UL)
+
+/* bl_mailbox_t shared with the application, the bootloader IRAM ends here */
+#define BL_MAILBOX_ADDR             (0x2002FFF0UL)
 #endif
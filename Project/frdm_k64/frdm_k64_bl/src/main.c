@@ -11,122 +11,618 @@
 #include "gpio.h"
 #include "uart.h"
 #include "flash.h"
+#include "mcg.h"
 #include "mcuboot.h"
+#include "mflash.h"
+#include "bl_mailbox.h"
+#include "bl_image.h"
+#include "bl_slot.h"
+#include "bl_journal.h"
+#include "bl_burst.h"
+#include "bl_loader.h"
 #include "bl_cfg.h"
 
 static uint8_t force_enter_bl = 0;
 static uint8_t timeout_jump = 0;
 static mcuboot_t mcuboot;
+static mflash_t mflash;
+#if (BL_IMAGE_CHECK == 1)
+static bl_image_t bl_image;
+#endif
+#if (BL_AB_SLOTS == 1)
+static bl_slot_t bl_slot;
+#define APP_REGION_SIZE     (BL_SLOT_SIZE)
+#elif (BL_FLASH_SWAP == 1)
+#define APP_REGION_SIZE     (BL_JOURNAL_ADDR - APPLICATION_BASE)
+#else
+#define APP_REGION_SIZE     (TARGET_FLASH_SIZE - APPLICATION_BASE - BL_IMAGE_CACHE_SIZE - BL_JOURNAL_SIZE)
+#endif
+#if (BL_JOURNAL == 1)
+static bl_journal_t bl_journal;
+#endif
+#if (BL_RAM_BURST == 1)
+static bl_burst_t bl_burst;
+static uint32_t burst_buf[BL_RAM_BURST_SIZE/4];
+#endif
+#if (BL_RAM_LOADER == 1)
+static bl_loader_api_t loader_api;
+#endif
 
+/* with BL_FLASH_SWAP the host addresses the linked image, flash operations go to block 1 */
+#if (BL_FLASH_SWAP == 1)
+#define DL_OFFSET           (BL_SWAP_BLOCK_SIZE)
+static uint8_t swap_pending = 0;
+#else
+#define DL_OFFSET           (0)
+#endif
+
+/* image started when the listen window closes, the selected slot with BL_AB_SLOTS */
+static uint32_t boot_base = APPLICATION_BASE;
+
+/* receive while flash commands run: wait loop in RAM, or application in the other flash block */
+#define BL_FLASH_RX_HOOK    ((CHLIB_RAMFUNC_SUPPORT == 1) || (BL_DUAL_BLOCK_RWW == 1) || (BL_AB_SLOTS == 1) || (BL_FLASH_SWAP == 1))
+
+#if (BL_CLOCK_PROFILE == 1)
+static ClockProfile_t clock_saved;
+static uint8_t clock_entered = 0;
+#endif
+
+/* UART0 receives from its watermark/idle interrupt into this ring */
+static uint8_t rx_ring[512];
+
+#if BL_FLASH_RX_HOOK
+/* called from the flash wait loop, must not touch flash on the same-block path */
+static RAMFUNC void flash_wait_rx(void)
+{
+    /* on the concurrent path interrupts are enabled and the IRQ is the other producer */
+    uint32_t primask = __get_PRIMASK();
+    
+    __disable_irq();
+    UART_RxPoll(HW_UART0);
+    __set_PRIMASK(primask);
+}
+#endif
+
+
+/* raw flash primitives, alignment and merging is done by mflash */
+static int flash_erase(uint32_t addr)
+{
+    return FLASH_EraseSector(addr);
+}
+
+static int flash_erase_block(uint32_t addr)
+{
+    return FLASH_EraseBlock(addr);
+}
+
+static int flash_program(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    return FLASH_WriteSector(addr, buf, len);
+}
+
+#if (BL_RAM_BURST == 1)
+/* a whole sector at a time, PGMSEC from the FlexRAM */
+static int flash_program_section(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    return FLASH_WriteSection(addr, buf, len);
+}
+#endif
+
+#if (BL_RAM_LOADER == 1)
+/* WriteMemory into the loader window is plain RAM */
+static int in_loader_ram(uint32_t addr, uint32_t len)
+{
+    return (addr >= BL_LOADER_RAM_START) && (len <= BL_LOADER_RAM_SIZE) && ((addr - BL_LOADER_RAM_START) <= (BL_LOADER_RAM_SIZE - len));
+}
+#endif
 
 static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
 {
-    int addr;
-    addr = start_addr;
+#if (BL_IMAGE_CHECK == 1)
+    /* a download starts, the cached verdict no longer holds */
+    bl_image_invalidate(&bl_image);
+#endif
+    return mflash_erase(&mflash, start_addr + DL_OFFSET, byte_cnt);
+}
 
-    while(addr < (byte_cnt + start_addr))
+static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
+{
+#if (BL_RAM_LOADER == 1)
+    if(in_loader_ram(start_addr, byte_cnt))
     {
-        FLASH_EraseSector(addr);
-        addr += FLASH_GetSectorSize();
+        memcpy((void*)start_addr, buf, byte_cnt);
+        return 0;
     }
-    return 0;
+#endif
+#if (BL_IMAGE_CHECK == 1)
+    bl_image_invalidate(&bl_image);
+#endif
+#if (BL_FLASH_SWAP == 1)
+    swap_pending = 1;
+#endif
+#if (BL_RAM_BURST == 1)
+    /* flash is only touched once the whole transfer is in RAM */
+    if(bl_burst_is_active(&bl_burst))
+    {
+        return bl_burst_write(&bl_burst, start_addr + DL_OFFSET, buf, byte_cnt);
+    }
+#endif
+#if (BL_JOURNAL == 1)
+    int ret;
+    
+    ret = mflash_write(&mflash, start_addr + DL_OFFSET, buf, byte_cnt);
+    bl_journal_write(&bl_journal, start_addr + DL_OFFSET, buf, byte_cnt);
+    return ret;
+#else
+    return mflash_write(&mflash, start_addr + DL_OFFSET, buf, byte_cnt);
+#endif
 }
 
-static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
+static int memory_flush(void)
 {
-    FLASH_WriteSector(start_addr, buf, byte_cnt);
+    int ret;
+    
+#if (BL_RAM_BURST == 1)
+    /* a buffered transfer goes to flash now, the journal sees it as one write */
+    if(bl_burst_is_active(&bl_burst))
+    {
+        ret = bl_burst_commit(&bl_burst);
+#if (BL_JOURNAL == 1)
+        if(ret == BL_BURST_OK)
+        {
+            bl_journal_write(&bl_journal, bl_burst.start, (const uint8_t*)bl_burst.cfg_buf, bl_burst.len);
+            bl_journal_flush(&bl_journal);
+        }
+#endif
+        return ret;
+    }
+#endif
+    ret = mflash_flush(&mflash);
+#if (BL_JOURNAL == 1)
+    bl_journal_flush(&bl_journal);
+#endif
+    return ret;
+}
+
+#if (BL_JOURNAL == 1) || (BL_RAM_BURST == 1)
+static int memory_begin(uint32_t addr, uint32_t len)
+{
+#if (BL_RAM_LOADER == 1)
+    /* a loader blob, the journal and the burst buffer are for flash */
+    if(in_loader_ram(addr, len))
+    {
+#if (BL_RAM_BURST == 1)
+        /* drops a flash transfer still buffered, it was cut off */
+        bl_burst_begin(&bl_burst, 0, 0);
+#endif
+        return 0;
+    }
+#endif
+#if (BL_JOURNAL == 1)
+    bl_journal_begin(&bl_journal, addr + DL_OFFSET, len);
+#endif
+#if (BL_RAM_BURST == 1)
+    /* a buffered transfer is programmed on flush, nothing is erased on demand meanwhile */
+    bl_burst_begin(&bl_burst, addr + DL_OFFSET, len);
+    return bl_burst_is_active(&bl_burst);
+#else
     return 0;
+#endif
 }
+#endif
+
+#if (BL_JOURNAL == 1)
+static uint8_t get_property(uint32_t tag, uint32_t *param)
+{
+    uint32_t start, len;
+    
+    if(tag != BL_JOURNAL_PROPERTY)
+    {
+        return 0;
+    }
+    
+    /* start, length and first incomplete address of the last WriteMemory, as the host addressed them */
+    param[3] = bl_journal_resume(&bl_journal, &start, &len) - DL_OFFSET;
+    param[1] = start - DL_OFFSET;
+    param[2] = len;
+    if(len == 0)
+    {
+        param[1] = 0;
+        param[3] = 0;
+    }
+    return 4;
+}
+#endif
 
 int memory_read(uint32_t addr, uint8_t *buf, uint32_t len)
 {
+#if (BL_FLASH_SWAP == 1)
+    /* read back what was downloaded */
+    if((addr >= APPLICATION_BASE) && (addr < APPLICATION_BASE + APP_REGION_SIZE))
+    {
+        addr += DL_OFFSET;
+    }
+#endif
     memcpy(buf, (void*)addr, len);
     return 0;
 }
 
 static int mcuboot_send(uint8_t *buf, uint32_t len)
 {
-    while(len--)
+    uint32_t n;
+    
+    /* one TX FIFO load per call */
+    while(len)
     {
-        UART_PutChar(HW_UART0, *buf++);
+        n = UART_Write(HW_UART0, buf, len);
+        buf += n;
+        len -= n;
     }
     return CH_OK;
 }
 
+#if (BL_FLASH_SWAP == 1)
+/* make the staged image active at the next reset, block 1 then appears at address 0 */
+static int swap_commit(void)
+{
+    FLASH_SwapStatus_t stat;
+    uint32_t addr, i;
+    uint32_t *vectorTable = (uint32_t*)(APPLICATION_BASE + DL_OFFSET);
+    
+    memory_flush();
+    if((vectorTable[1] < APPLICATION_BASE) || (vectorTable[1] > APPLICATION_BASE + APP_REGION_SIZE) ||
+       (bl_image_check(&bl_image, APPLICATION_BASE + DL_OFFSET, NULL) != BL_IMAGE_OK))
+    {
+        return CH_ERR;
+    }
+    
+    /* block 1 boots after the swap, it needs this bootloader and flash config field */
+    if(memcmp((void*)DL_OFFSET, (void*)0, APPLICATION_BASE) != 0)
+    {
+        for(addr = 0; addr < APPLICATION_BASE; addr += FLASH_GetSectorSize())
+        {
+            if(flash_erase(addr + DL_OFFSET) || flash_program(addr + DL_OFFSET, (const uint8_t*)addr, FLASH_GetSectorSize()))
+            {
+                return CH_ERR;
+            }
+        }
+    }
+    
+    /* walk the swap state machine to complete, the indicator twin in block 1 is erased on the way */
+    for(i=0; i<8; i++)
+    {
+        if(FLASH_SwapControl(BL_SWAP_INDICATOR_ADDR, kFLASH_SwapReport, &stat))
+        {
+            return CH_ERR;
+        }
+        
+        switch(stat.mode)
+        {
+            case kFLASH_SwapModeUninit:
+                flash_erase(BL_SWAP_INDICATOR_ADDR);
+                flash_erase(BL_SWAP_INDICATOR_ADDR + DL_OFFSET);
+                FLASH_SwapControl(BL_SWAP_INDICATOR_ADDR, kFLASH_SwapInit, NULL);
+                break;
+            case kFLASH_SwapModeReady:
+                FLASH_SwapControl(BL_SWAP_INDICATOR_ADDR, kFLASH_SwapUpdate, NULL);
+                break;
+            case kFLASH_SwapModeUpdate:
+                flash_erase(BL_SWAP_INDICATOR_ADDR + DL_OFFSET);
+                break;
+            case kFLASH_SwapModeUpdateErased:
+                FLASH_SwapControl(BL_SWAP_INDICATOR_ADDR, kFLASH_SwapComplete, NULL);
+                break;
+            case kFLASH_SwapModeComplete:
+                swap_pending = 0;
+                return CH_OK;
+            default:
+                return CH_ERR;
+        }
+    }
+    return CH_ERR;
+}
+#endif
+
 static void mcuboot_reset(void)
 {
-    /* delay for a while to wait mcuboot send respond packet */
-    DelayMs(100);
+#if (BL_FLASH_SWAP == 1)
+    /* activate a download of this session, an image that fails validation is not swapped in */
+    if(swap_pending)
+    {
+        swap_commit();
+    }
+#endif
+    /* the response has left the shifter */
+    UART_WaitTxComplete(HW_UART0);
     NVIC_SystemReset();
 }
 
 static void mcuboot_complete(void) {}
 
-bool is_app_addr_validate(void)
+#if (BL_RAM_LOADER == 1)
+static uint32_t link_read(uint8_t *buf, uint32_t len)
+{
+    return UART_Read(HW_UART0, buf, len);
+}
+
+/* Call: a flash loader blob in the loader window, see bl_loader.h */
+static uint32_t mcuboot_call(uint32_t addr, uint32_t arg)
+{
+    loader_api.core_clock = SystemCoreClock;
+    return bl_loader_call(&loader_api, addr, arg);
+}
+#endif
+
+#if (BL_CLOCK_PROFILE == 1)
+/* the host waits for the answer to its first frame, UART0 runs from the core clock and follows it */
+static void mcuboot_connect(void)
+{
+    if(ClockProfileEnter(&clock_saved) == CH_OK)
+    {
+        clock_entered = 1;
+        DelayInit();
+        UART_SetBaudRate(HW_UART0, 115200);
+        FLASH_Init();
+    }
+}
+#endif
+
+static bool image_validate(uint32_t base)
 {
-    uint32_t *vectorTable = (uint32_t*)APPLICATION_BASE;
+    uint32_t *vectorTable = (uint32_t*)base;
     uint32_t pc = vectorTable[1];
     
-    if (pc < APPLICATION_BASE || pc > (APPLICATION_BASE + TARGET_FLASH_SIZE))
+    if (pc < base || pc > (base + APP_REGION_SIZE))
     {
         return false;
     }
-    else
+#if (BL_IMAGE_CHECK == 1)
+    /* an interrupted or corrupted download fails the CRC */
+    if(bl_image_check(&bl_image, base, NULL) != BL_IMAGE_OK)
     {
-        return true;
-    } 
+        return false;
+    }
+#endif
+    return true;
+}
+
+bool is_app_addr_validate(void)
+{
+    return image_validate(boot_base);
 }
 
+#if (BL_AB_SLOTS == 1)
+static int slot_validate(uint32_t base)
+{
+    return (image_validate(base) == true)?(0):(1);
+}
+#endif
+
 static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
 {
+#if (BL_FLASH_SWAP == 1)
+    /* the new image only runs after the swap reset */
+    if(swap_pending)
+    {
+        mcuboot_reset();
+    }
+#endif
+#if (BL_AB_SLOTS == 1)
+    /* Execute at the download slot activates it, any other address starts the running slot */
+    if(addr == bl_slot_inactive(&bl_slot))
+    {
+        if(bl_slot_activate(&bl_slot, (addr == BL_SLOT_A_BASE)?(0):(1)) != BL_SLOT_OK)
+        {
+            return;
+        }
+        boot_base = addr;
+    }
+    addr = boot_base;
+#endif
     if(is_app_addr_validate() == true)
     {
+        /* the Execute response leaves the line before the application takes the UART */
+        UART_WaitTxComplete(HW_UART0);
         /* clean up resouces */
+        UART_SetIntMode(HW_UART0, kUART_IntRx, false);
+        UART_SetIntMode(HW_UART0, kUART_IntIdleLine, false);
+        NVIC_DisableIRQ(UART0_RX_TX_IRQn);
+#if (BL_CLOCK_PROFILE == 1)
+        /* the application starts with the clocks of a reset */
+        if(clock_entered)
+        {
+            ClockProfileExit(&clock_saved);
+        }
+#endif
         JumpToImage(addr);
     }
 }
 
 int main(void)
 {
-    uint8_t c;
+    uint8_t buf[64];
+    uint32_t n = 0, pos = 0;
+    FLASH_Geometry_t geo;
+    
+#if (BL_IMAGE_CHECK == 1)
+    /* ready before the first is_app_addr_validate, which may write the verdict */
+    FLASH_Init();
+    FLASH_GetGeometry(&geo);
+    bl_image.cfg_max_size = APP_REGION_SIZE;
+    bl_image.cfg_cache_addr = BL_IMAGE_CACHE_ADDR;
+    bl_image.cfg_cache_size = BL_IMAGE_CACHE_SIZE;
+    bl_image.cfg_erase_unit = geo.erase_unit;
+    bl_image.cfg_program_unit = geo.program_unit;
+    bl_image.op_erase = flash_erase;
+    bl_image.op_program = flash_program;
+    bl_image_init(&bl_image);
+#endif
+#if (BL_AB_SLOTS == 1)
+    bl_slot.cfg_base[0] = BL_SLOT_A_BASE;
+    bl_slot.cfg_base[1] = BL_SLOT_B_BASE;
+    bl_slot.cfg_table_addr = BL_SLOT_TABLE_ADDR;
+    bl_slot.cfg_erase_unit = geo.erase_unit;
+    bl_slot.cfg_program_unit = geo.program_unit;
+    bl_slot.op_erase = flash_erase;
+    bl_slot.op_program = flash_program;
+    bl_slot.op_validate = slot_validate;
+    bl_slot_init(&bl_slot);
+    
+    /* the activated slot, or the previous one when it fails validation */
+    bl_slot_select(&bl_slot);
+    boot_base = bl_slot.cfg_base[bl_slot.boot];
+#endif
+    
+    /* an update request from the application keeps the bootloader open, it is served once */
+    force_enter_bl = (bl_mailbox_take((bl_mailbox_t*)BL_MAILBOX_ADDR, NULL) == BL_MAILBOX_CMD_ENTER);
+#if (BL_FAST_BOOT == 1)
+    if((force_enter_bl == 0) && is_app_addr_validate())
+    {
+        JumpToImage(boot_base);
+    }
+#endif
+    
     DelayInit();
     
     UART_Init(UART0_RX_PB16_TX_PB17, 115200);
+    
+    /* 8 entry FIFOs, interrupt at half full leaves 4 byte times of latency */
+    UART_EnableTxFIFO(HW_UART0, true);
+    UART_EnableRxFIFO(HW_UART0, true);
+    UART_SetRxWatermark(HW_UART0, UART_GetFIFODepth(HW_UART0, false) / 2);
+    UART_EnableRxRing(HW_UART0, rx_ring, sizeof(rx_ring));
+#if (BL_UART_FLOW_CONTROL == 1)
+    UART_EnableFlowControl(UART0_RTS_PB02_CTS_PB03, sizeof(rx_ring) / 2);
+#endif
 
+    /* config the flash engine from the driver geometry */
+    FLASH_GetGeometry(&geo);
+#if (BL_AB_SLOTS == 1)
+    /* the host only reaches the slot that is not running */
+    mflash.cfg_start = bl_slot_inactive(&bl_slot);
+#else
+    mflash.cfg_start = APPLICATION_BASE + DL_OFFSET;
+#endif
+    mflash.cfg_size = APP_REGION_SIZE;
+    mflash.cfg_erase_unit = geo.erase_unit;
+    mflash.cfg_program_unit = geo.program_unit;
+    mflash.cfg_erase_time_us = geo.erase_time_us;
+    mflash.cfg_program_time_us = geo.program_time_us;
+    mflash.cfg_block_size = geo.block_size;
+    mflash.op_erase = flash_erase;
+    mflash.op_program = flash_program;
+    mflash.op_erase_block = flash_erase_block;
+    mflash_init(&mflash);
+    
+#if (BL_JOURNAL == 1)
+    /* progress of an interrupted download survives the reset */
+    bl_journal.cfg_addr = BL_JOURNAL_ADDR;
+    bl_journal.cfg_size = BL_JOURNAL_SIZE;
+    bl_journal.cfg_erase_unit = geo.erase_unit;
+    bl_journal.cfg_program_unit = geo.program_unit;
+    bl_journal.cfg_sector_size = geo.erase_unit;
+    bl_journal.op_erase = flash_erase;
+    bl_journal.op_program = flash_program;
+    bl_journal_init(&bl_journal);
+#endif
+    
+#if (BL_RAM_BURST == 1)
+    /* transfers up to the buffer size are received into RAM, then programmed in one go */
+    bl_burst.cfg_start = mflash.cfg_start;
+    bl_burst.cfg_size = mflash.cfg_size;
+    bl_burst.cfg_buf = burst_buf;
+    bl_burst.cfg_buf_size = sizeof(burst_buf);
+    bl_burst.cfg_erase_unit = geo.erase_unit;
+    bl_burst.cfg_program_unit = geo.program_unit;
+    bl_burst.op_program = flash_program_section;
+#endif
+    
+#if (BL_RAM_LOADER == 1)
+    /* what a loader started by Call gets, the flash region is the one the host sees */
+    loader_api.abi = BL_LOADER_ABI;
+    loader_api.flash_start = mflash.cfg_start - DL_OFFSET;
+    loader_api.flash_size = APP_REGION_SIZE;
+    loader_api.erase_unit = geo.erase_unit;
+    loader_api.program_unit = geo.program_unit;
+    loader_api.ram_start = BL_LOADER_RAM_START;
+    loader_api.ram_size = BL_LOADER_RAM_SIZE;
+    loader_api.erase = memory_erase;
+    loader_api.write = memory_write;
+    loader_api.flush = memory_flush;
+    loader_api.read = memory_read;
+    loader_api.link_read = link_read;
+    loader_api.link_send = mcuboot_send;
+#endif
+    
     /* config the mcuboot */
     mcuboot.op_send = mcuboot_send;
     mcuboot.op_reset = mcuboot_reset;
     mcuboot.op_jump = mcuboot_jump;
     mcuboot.op_complete = mcuboot_complete;
+#if (BL_CLOCK_PROFILE == 1)
+    mcuboot.op_connect = mcuboot_connect;
+#endif
+#if (BL_RAM_LOADER == 1)
+    mcuboot.op_call = mcuboot_call;
+#endif
     
     mcuboot.op_mem_erase = memory_erase;
     mcuboot.op_mem_write = memory_write;
     mcuboot.op_mem_read = memory_read;
+    mcuboot.op_mem_flush = memory_flush;
+#if (BL_JOURNAL == 1) || (BL_RAM_BURST == 1)
+    mcuboot.op_mem_begin = memory_begin;
+#endif
+#if (BL_JOURNAL == 1)
+    mcuboot.op_get_property = get_property;
+#endif
     
-    mcuboot.cfg_flash_start = APPLICATION_BASE; 
-    mcuboot.cfg_flash_size = TARGET_FLASH_SIZE;
+    mcuboot.cfg_flash_start = mflash.cfg_start - DL_OFFSET; 
+    mcuboot.cfg_flash_size = APP_REGION_SIZE;
     mcuboot.cfg_flash_sector_size = FLASH_GetSectorSize();
+#if (BL_RAM_LOADER == 1)
+    mcuboot.cfg_ram_start = BL_LOADER_RAM_START;
+    mcuboot.cfg_ram_size = BL_LOADER_RAM_SIZE;
+#else
     mcuboot.cfg_ram_start = 0x20000000;
     mcuboot.cfg_ram_size = 128*1024;
+#endif
     mcuboot.cfg_device_id = 0x12345678;
     mcuboot.cfg_uuid = GetUID();
     
     mcuboot_init(&mcuboot);
     
     FLASH_Init();
+#if BL_FLASH_RX_HOOK
+    FLASH_SetWaitHook(flash_wait_rx);
+#if (CHLIB_RAMFUNC_SUPPORT == 0) && ((BL_AB_SLOTS == 1) || (BL_FLASH_SWAP == 1))
+    /* without the RAM wait loop only block 1 downloads keep receiving */
+    mcuboot.cfg_ack_before_write = FLASH_IsConcurrentSafe(mflash.cfg_start);
+#else
+    mcuboot.cfg_ack_before_write = 1;
+#endif
+#endif
+#if (BL_UART_FLOW_CONTROL == 1)
+    /* RTS holds the host back when the ring fills up during a flash command */
+    mcuboot.cfg_ack_before_write = 1;
+#endif
     SysTick_SetTime(100*1000);
     SysTick_SetIntMode(true);
     
     while(1)
     {
-        if(UART_GetChar(HW_UART0, &c) == CH_OK)
+        if(pos == n)
         {
-            mcuboot_recv(&mcuboot, &c, 1);
+            n = UART_Read(HW_UART0, buf, sizeof(buf));
+            pos = 0;
         }
+        /* a chunk may hold the end of one frame and the start of the next, the decoder stops
+           after the first, the rest is passed again once mcuboot_proc has handled it */
+        pos += mcuboot_recv(&mcuboot, buf + pos, n - pos);
         
         if(timeout_jump == 1)
         {
-            mcuboot_jump(APPLICATION_BASE, 0, 0);
+            mcuboot_jump(boot_base, 0, 0);
             timeout_jump = 0;
         }
         mcuboot_proc(&mcuboot);
@@ -12,6 +12,23 @@
 /* Base address of user application */
 #define APPLICATION_BASE            (0x8000UL)
 #define BL_TIMEOUT_MS               (300)
+/* physical flash size, the application region runs from APPLICATION_BASE up to its end */
 #define TARGET_FLASH_SIZE           (64*1024)
 
+/* 1: jump to a valid application at once, the listen window only opens on a mailbox request */
+#ifndef BL_FAST_BOOT
+#define BL_FAST_BOOT                (0)
+#endif
+
+/* 1: start only an image whose bl_image header (length, CRC32) matches, pc_tool/image_patch fills it in */
+#ifndef BL_IMAGE_CHECK
+#define BL_IMAGE_CHECK              (0)
+#endif
+
+/* the check result is cached in the EEPROM, see FLASH_EEP_WriteSector */
+#define BL_IMAGE_CACHE_ADDR         (0x10000000UL)
+#define BL_IMAGE_CACHE_SIZE         (64)
+
+/* bl_mailbox_t shared with the application, the bootloader IRAM ends here */
+#define BL_MAILBOX_ADDR             (0x20000BF0UL)
 #endif
@@ -12,6 +12,27 @@
 /* Base address of user application */
 #define APPLICATION_BASE            (3*1024)
 #define BL_TIMEOUT_MS               (300)
-#define TARGET_FLASH_SIZE           (5*1024)
+/* physical flash size, the application region runs from APPLICATION_BASE up to its end */
+#define TARGET_FLASH_SIZE           (8*1024)
 
+/* 1: jump to a valid application at once, the listen window only opens on a mailbox request */
+#ifndef BL_FAST_BOOT
+#define BL_FAST_BOOT                (0)
+#endif
+
+/* 1: start only an image whose bl_image header (length, CRC32) matches, pc_tool/image_patch fills it in */
+#ifndef BL_IMAGE_CHECK
+#define BL_IMAGE_CHECK              (0)
+#endif
+
+/* the check result is cached in the last sector of the flash, the application region ends below it */
+#if (BL_IMAGE_CHECK == 1)
+#define BL_IMAGE_CACHE_SIZE         (512)
+#else
+#define BL_IMAGE_CACHE_SIZE         (0)
+#endif
+#define BL_IMAGE_CACHE_ADDR         (TARGET_FLASH_SIZE - BL_IMAGE_CACHE_SIZE)
+
+/* bl_mailbox_t shared with the application, the bootloader IRAM ends here */
+#define BL_MAILBOX_ADDR             (0x200002F0UL)
 #endif
@@ -12,30 +12,54 @@
 #include "uart.h"
 #include "flash.h"
 #include "mcuboot.h"
+#include "mflash.h"
+#include "bl_mailbox.h"
+#include "bl_image.h"
 #include "bl_cfg.h"
 
+/* the application owns the flash from APPLICATION_BASE to the end, less the verdict cache */
+#define APP_REGION_SIZE     (TARGET_FLASH_SIZE - APPLICATION_BASE - BL_IMAGE_CACHE_SIZE)
+
 static uint8_t force_enter_bl = 0;
 static uint8_t timeout_jump = 0;
 static mcuboot_t mcuboot;
+static mflash_t mflash;
+#if (BL_IMAGE_CHECK == 1)
+static bl_image_t bl_image;
+#endif
 
 
-static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
+/* raw flash primitives, alignment and merging is done by mflash */
+static int flash_erase(uint32_t addr)
 {
-    int addr;
-    addr = start_addr;
+    return FLASH_EraseSector(addr);
+}
 
-    while(addr < (byte_cnt + start_addr))
-    {
-        FLASH_EraseSector(addr);
-        addr += FLASH_GetSectorSize();
-    }
-    return 0;
+static int flash_program(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    return FLASH_WriteSector(addr, buf, len);
+}
+
+static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
+{
+#if (BL_IMAGE_CHECK == 1)
+    /* a download starts, the cached verdict no longer holds */
+    bl_image_invalidate(&bl_image);
+#endif
+    return mflash_erase(&mflash, start_addr, byte_cnt);
 }
 
 static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
 {
-    FLASH_WriteSector(start_addr, buf, byte_cnt);
-    return 0;
+#if (BL_IMAGE_CHECK == 1)
+    bl_image_invalidate(&bl_image);
+#endif
+    return mflash_write(&mflash, start_addr, buf, byte_cnt);
+}
+
+static int memory_flush(void)
+{
+    return mflash_flush(&mflash);
 }
 
 int memory_read(uint32_t addr, uint8_t *buf, uint32_t len)
@@ -55,8 +79,8 @@ static int mcuboot_send(uint8_t *buf, uint32_t len)
 
 static void mcuboot_reset(void)
 {
-    /* delay for a while to wait mcuboot send respond packet */
-    DelayMs(100);
+    /* the response has left the shifter */
+    UART_WaitTxComplete(HW_UART0);
     NVIC_SystemReset();
 }
 
@@ -67,20 +91,26 @@ bool is_app_addr_validate(void)
     uint32_t *vectorTable = (uint32_t*)APPLICATION_BASE;
     uint32_t pc = vectorTable[1];
     
-    if (pc < APPLICATION_BASE || pc > (APPLICATION_BASE + TARGET_FLASH_SIZE))
+    if (pc < APPLICATION_BASE || pc > (APPLICATION_BASE + APP_REGION_SIZE))
     {
         return false;
     }
-    else
+#if (BL_IMAGE_CHECK == 1)
+    /* an interrupted or corrupted download fails the CRC */
+    if(bl_image_check(&bl_image, APPLICATION_BASE, NULL) != BL_IMAGE_OK)
     {
-        return true;
-    } 
+        return false;
+    }
+#endif
+    return true;
 }
 
 static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
 {
     if(is_app_addr_validate() == true)
     {
+        /* the Execute response leaves the line before the application takes the UART */
+        UART_WaitTxComplete(HW_UART0);
         /* clean up resouces */
         JumpToImage(addr);
     }
@@ -107,7 +137,31 @@ static void ICS_FEE_20M(void)
 int main(void)
 {
     uint8_t c;
+    FLASH_Geometry_t geo;
 
+#if (BL_IMAGE_CHECK == 1)
+    /* ready before the first is_app_addr_validate, which may write the verdict */
+    FLASH_Init();
+    FLASH_GetGeometry(&geo);
+    bl_image.cfg_max_size = BL_IMAGE_CACHE_ADDR - APPLICATION_BASE;
+    bl_image.cfg_cache_addr = BL_IMAGE_CACHE_ADDR;
+    bl_image.cfg_cache_size = BL_IMAGE_CACHE_SIZE;
+    bl_image.cfg_erase_unit = geo.erase_unit;
+    bl_image.cfg_program_unit = geo.program_unit;
+    bl_image.op_erase = flash_erase;
+    bl_image.op_program = flash_program;
+    bl_image_init(&bl_image);
+#endif
+    
+    /* an update request from the application keeps the bootloader open, it is served once */
+    force_enter_bl = (bl_mailbox_take((bl_mailbox_t*)BL_MAILBOX_ADDR, NULL) == BL_MAILBOX_CMD_ENTER);
+#if (BL_FAST_BOOT == 1)
+    if((force_enter_bl == 0) && is_app_addr_validate())
+    {
+        JumpToImage(APPLICATION_BASE);
+    }
+#endif
+    
     ICS_FEE_20M();
     DelayInit();
     
@@ -115,6 +169,19 @@ int main(void)
     UART_Init(HW_UART0, 115200);
 
         
+    /* config the flash engine from the driver geometry */
+    FLASH_GetGeometry(&geo);
+    mflash.cfg_start = APPLICATION_BASE;
+    mflash.cfg_size = APP_REGION_SIZE;
+    mflash.cfg_erase_unit = geo.erase_unit;
+    mflash.cfg_program_unit = geo.program_unit;
+    mflash.cfg_erase_time_us = geo.erase_time_us;
+    mflash.cfg_program_time_us = geo.program_time_us;
+    mflash.cfg_block_size = geo.block_size;
+    mflash.op_erase = flash_erase;
+    mflash.op_program = flash_program;
+    mflash_init(&mflash);
+    
     /* config the mcuboot */
     mcuboot.op_send = mcuboot_send;
     mcuboot.op_reset = mcuboot_reset;
@@ -124,9 +191,10 @@ int main(void)
     mcuboot.op_mem_erase = memory_erase;
     mcuboot.op_mem_write = memory_write;
     mcuboot.op_mem_read = memory_read;
+    mcuboot.op_mem_flush = memory_flush;
     
     mcuboot.cfg_flash_start = APPLICATION_BASE; 
-    mcuboot.cfg_flash_size = TARGET_FLASH_SIZE;
+    mcuboot.cfg_flash_size = APP_REGION_SIZE;
     mcuboot.cfg_flash_sector_size = FLASH_GetSectorSize();
     mcuboot.cfg_ram_start = 0x1FFFFF00;
     mcuboot.cfg_ram_size = 4*1024;
@@ -12,6 +12,41 @@
 /* Base address of user application */
 #define APPLICATION_BASE            (0x8000UL)
 #define BL_TIMEOUT_MS               (300)
+/* physical flash size, the application region runs from APPLICATION_BASE up to its end */
 #define TARGET_FLASH_SIZE           (256*1024)
 
+/* multi-drop RS-485, needs MCUBOOT_MULTIDROP=1 in the project defines:
+   node id 1..254, 0: derived from the unique id */
+#define BL_NODE_ID                  (0)
+
+/* LPUART1_RTS_b drives the transceiver DE, check the pin mux table of the part */
+#define BL_RS485_DE_PORT            (HW_GPIOE)
+#define BL_RS485_DE_PIN             (6)
+#define BL_RS485_DE_MUX             (6)
+
+/* 1: jump to a valid application at once, the listen window only opens on a mailbox request */
+#ifndef BL_FAST_BOOT
+#define BL_FAST_BOOT                (0)
+#endif
+
+/* 1: start only an image whose bl_image header (length, CRC32) matches, pc_tool/image_patch fills it in */
+#ifndef BL_IMAGE_CHECK
+#define BL_IMAGE_CHECK              (0)
+#endif
+
+/* the check result is cached in the last sector of the flash, the application region ends below it */
+#if (BL_IMAGE_CHECK == 1)
+#define BL_IMAGE_CACHE_SIZE         (2048)
+#else
+#define BL_IMAGE_CACHE_SIZE         (0)
+#endif
+#define BL_IMAGE_CACHE_ADDR         (TARGET_FLASH_SIZE - BL_IMAGE_CACHE_SIZE)
+
+/* 1: run at LPFLL 72MHz from the first host frame on, the reset clocks are restored before the jump */
+#ifndef BL_CLOCK_PROFILE
+#define BL_CLOCK_PROFILE            (0)
+#endif
+
+/* bl_mailbox_t shared with the application, the bootloader IRAM ends here */
+#define BL_MAILBOX_ADDR             (0x20005FF0UL)
 #endif
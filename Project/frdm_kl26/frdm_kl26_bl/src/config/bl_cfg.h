@@ -12,6 +12,30 @@
 /* Base address of user application */
 #define APPLICATION_BASE            (0x8000UL)
 #define BL_TIMEOUT_MS               (300)
-#define TARGET_FLASH_SIZE           (32*1024)
+/* physical flash size, the application region runs from APPLICATION_BASE up to its end */
+#define TARGET_FLASH_SIZE           (128*1024)
 
+/* 1: jump to a valid application at once, the listen window only opens on a mailbox request */
+#ifndef BL_FAST_BOOT
+#define BL_FAST_BOOT                (0)
+#endif
+
+/* 1: start only an image whose bl_image header (length, CRC32) matches, pc_tool/image_patch fills it in */
+#ifndef BL_IMAGE_CHECK
+#define BL_IMAGE_CHECK              (0)
+#endif
+
+/* the check result is cached in the last sector of the flash, the application region ends below it */
+#if (BL_IMAGE_CHECK == 1)
+#define BL_IMAGE_CACHE_SIZE         (1024)
+#else
+#define BL_IMAGE_CACHE_SIZE         (0)
+#endif
+#define BL_IMAGE_CACHE_ADDR         (TARGET_FLASH_SIZE - BL_IMAGE_CACHE_SIZE)
+
+/* DMA reception and sending are opt-in: CHLIB_DMA_SUPPORT defaults to 0 in drivers_kl common.h
+   and frdm_kl26_bl.uvprojx does not define it, add CHLIB_DMA_SUPPORT=1 to the C/C++ defines */
+
+/* bl_mailbox_t shared with the application, the bootloader IRAM ends here */
+#define BL_MAILBOX_ADDR             (0x200017F0UL)
 #endif
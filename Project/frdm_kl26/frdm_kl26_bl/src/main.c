@@ -10,42 +10,93 @@
 #include "common.h"
 #include "gpio.h"
 #include "uart.h"
+#include "dma.h"
 #include "flash.h"
 #include "mcuboot.h"
+#include "mflash.h"
+#include "bl_mailbox.h"
+#include "bl_image.h"
 #include "bl_cfg.h"
 
+/* the application owns the flash from APPLICATION_BASE to the end, less the verdict cache */
+#define APP_REGION_SIZE     (TARGET_FLASH_SIZE - APPLICATION_BASE - BL_IMAGE_CACHE_SIZE)
+
 #define CH_OK (0)
 
 static uint8_t force_enter_bl = 0;
 static uint8_t timeout_jump = 0;
 static mcuboot_t mcuboot;
+static mflash_t mflash;
+#if (BL_IMAGE_CHECK == 1)
+static bl_image_t bl_image;
+#endif
 
+#if (CHLIB_DMA_SUPPORT == 1)
+/* UART0 RX runs into this ring by DMA, also while a flash command stalls the CPU */
+#define BL_UART_RX_DMA_CHL      (HW_DMA_CH0)
+#define BL_UART_TX_DMA_CHL      (HW_DMA_CH1)
+static uint8_t rx_ring[256] __attribute__((aligned(256)));
+#elif (CHLIB_RAMFUNC_SUPPORT == 1)
+/* bytes received while a flash command is running */
+static uint8_t flash_rx_buf[256];
+static volatile uint32_t flash_rx_in, flash_rx_out;
 
-static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
+/* called from the RAM flash wait loop with interrupts disabled, must not touch flash */
+static RAMFUNC void flash_wait_rx(void)
 {
-    int addr;
-    addr = start_addr;
+    if(UART0->S1 & UART0_S1_RDRF_MASK)
+    {
+        flash_rx_buf[flash_rx_in++ & (sizeof(flash_rx_buf) - 1)] = UART0->D;
+    }
+}
+#endif
 
-    if(start_addr >= APPLICATION_BASE)
+#if (CHLIB_DMA_SUPPORT == 0)
+static uint32_t bl_getc(uint8_t *c)
+{
+#if (CHLIB_RAMFUNC_SUPPORT == 1)
+    if(flash_rx_out != flash_rx_in)
     {
-        while(addr < (byte_cnt + start_addr))
-        {
-            FLASH_EraseSector(addr);
-            addr += FLASH_GetSectorSize();
-        }
+        *c = flash_rx_buf[flash_rx_out++ & (sizeof(flash_rx_buf) - 1)];
+        return CH_OK;
     }
+#endif
+    return UART_GetChar(HW_UART0, c);
+}
+#endif
 
-    return 0;
+
+/* raw flash primitives, alignment and merging is done by mflash */
+static int flash_erase(uint32_t addr)
+{
+    return FLASH_EraseSector(addr);
+}
+
+static int flash_program(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    return FLASH_WriteSector(addr, buf, len);
+}
+
+static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
+{
+#if (BL_IMAGE_CHECK == 1)
+    /* a download starts, the cached verdict no longer holds */
+    bl_image_invalidate(&bl_image);
+#endif
+    return mflash_erase(&mflash, start_addr, byte_cnt);
 }
 
 static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
 {
-    if(start_addr >= APPLICATION_BASE)
-    {
-        FLASH_WriteSector(start_addr, buf, byte_cnt);
-    }
+#if (BL_IMAGE_CHECK == 1)
+    bl_image_invalidate(&bl_image);
+#endif
+    return mflash_write(&mflash, start_addr, buf, byte_cnt);
+}
 
-    return 0;
+static int memory_flush(void)
+{
+    return mflash_flush(&mflash);
 }
 
 int memory_read(uint32_t addr, uint8_t *buf, uint32_t len)
@@ -54,6 +105,18 @@ int memory_read(uint32_t addr, uint8_t *buf, uint32_t len)
     return 0;
 }
 
+#if (CHLIB_DMA_SUPPORT == 1)
+/* hand the frame to DMA and return, mcuboot waits on mcuboot_send_is_busy before reusing buf */
+static int mcuboot_send(uint8_t *buf, uint32_t len)
+{
+    return UART_DMASend(HW_UART0, BL_UART_TX_DMA_CHL, buf, len);
+}
+
+static int mcuboot_send_is_busy(void)
+{
+    return (UART_DMAGetRemain(HW_UART0) != 0);
+}
+#else
 static int mcuboot_send(uint8_t *buf, uint32_t len)
 {
     while(len--)
@@ -62,11 +125,12 @@ static int mcuboot_send(uint8_t *buf, uint32_t len)
     }
     return CH_OK;
 }
+#endif
 
 static void mcuboot_reset(void)
 {
-    /* delay for a while to wait mcuboot send respond packet */
-    DelayMs(100);
+    /* the response has left the shifter */
+    UART_WaitTxComplete(HW_UART0);
     NVIC_SystemReset();
 }
 
@@ -77,21 +141,31 @@ bool is_app_addr_validate(void)
     uint32_t *vectorTable = (uint32_t*)APPLICATION_BASE;
     uint32_t pc = vectorTable[1];
     
-    if (pc < APPLICATION_BASE || pc > (APPLICATION_BASE + TARGET_FLASH_SIZE))
+    if (pc < APPLICATION_BASE || pc > (APPLICATION_BASE + APP_REGION_SIZE))
     {
         return false;
     }
-    else
+#if (BL_IMAGE_CHECK == 1)
+    /* an interrupted or corrupted download fails the CRC */
+    if(bl_image_check(&bl_image, APPLICATION_BASE, NULL) != BL_IMAGE_OK)
     {
-        return true;
-    } 
+        return false;
+    }
+#endif
+    return true;
 }
 
 static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
 {
     if(is_app_addr_validate() == true)
     {
+        /* the Execute response leaves the line before the application takes the UART */
+        UART_WaitTxComplete(HW_UART0);
 //        /* clean up resouces */
+#if (CHLIB_DMA_SUPPORT == 1)
+        DMA_DisableReq(BL_UART_RX_DMA_CHL);
+        UART_SetDMAMode(HW_UART0, kUART_DMARx, false);
+#endif
         JumpToImage(addr);
     }
 }
@@ -102,14 +176,63 @@ static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
 
 int main(void)
 {
+#if (CHLIB_DMA_SUPPORT == 1)
+    uint8_t buf[64];
+    uint32_t n = 0, pos = 0;
+#else
     uint8_t c;
+#endif
+    FLASH_Geometry_t geo;
+    
+#if (BL_IMAGE_CHECK == 1)
+    /* ready before the first is_app_addr_validate, which may write the verdict */
+    FLASH_Init();
+    FLASH_GetGeometry(&geo);
+    bl_image.cfg_max_size = BL_IMAGE_CACHE_ADDR - APPLICATION_BASE;
+    bl_image.cfg_cache_addr = BL_IMAGE_CACHE_ADDR;
+    bl_image.cfg_cache_size = BL_IMAGE_CACHE_SIZE;
+    bl_image.cfg_erase_unit = geo.erase_unit;
+    bl_image.cfg_program_unit = geo.program_unit;
+    bl_image.op_erase = flash_erase;
+    bl_image.op_program = flash_program;
+    bl_image_init(&bl_image);
+#endif
+    
+    /* an update request from the application keeps the bootloader open, it is served once */
+    force_enter_bl = (bl_mailbox_take((bl_mailbox_t*)BL_MAILBOX_ADDR, NULL) == BL_MAILBOX_CMD_ENTER);
+#if (BL_FAST_BOOT == 1)
+    if((force_enter_bl == 0) && is_app_addr_validate())
+    {
+        JumpToImage(APPLICATION_BASE);
+    }
+#endif
+    
     DelayInit();
     
     UART_Init(UART0_RX_PA01_TX_PA02, 115200);    
+#if (CHLIB_DMA_SUPPORT == 1)
+    UART_DMARecvStart(HW_UART0, BL_UART_RX_DMA_CHL, rx_ring, sizeof(rx_ring));
+#endif
 
 
+    /* config the flash engine from the driver geometry */
+    FLASH_GetGeometry(&geo);
+    mflash.cfg_start = APPLICATION_BASE;
+    mflash.cfg_size = APP_REGION_SIZE;
+    mflash.cfg_erase_unit = geo.erase_unit;
+    mflash.cfg_program_unit = geo.program_unit;
+    mflash.cfg_erase_time_us = geo.erase_time_us;
+    mflash.cfg_program_time_us = geo.program_time_us;
+    mflash.cfg_block_size = geo.block_size;
+    mflash.op_erase = flash_erase;
+    mflash.op_program = flash_program;
+    mflash_init(&mflash);
+    
     /* config the mcuboot */
     mcuboot.op_send = mcuboot_send;
+#if (CHLIB_DMA_SUPPORT == 1)
+    mcuboot.op_send_is_busy = mcuboot_send_is_busy;
+#endif
     mcuboot.op_reset = mcuboot_reset;
     mcuboot.op_jump = mcuboot_jump;
     mcuboot.op_complete = mcuboot_complete;
@@ -117,9 +240,10 @@ int main(void)
     mcuboot.op_mem_erase = memory_erase;
     mcuboot.op_mem_write = memory_write;
     mcuboot.op_mem_read = memory_read;
+    mcuboot.op_mem_flush = memory_flush;
     
     mcuboot.cfg_flash_start = APPLICATION_BASE; 
-    mcuboot.cfg_flash_size = TARGET_FLASH_SIZE;
+    mcuboot.cfg_flash_size = APP_REGION_SIZE;
     mcuboot.cfg_flash_sector_size = FLASH_GetSectorSize();
     mcuboot.cfg_ram_start = 0x20000000;
     mcuboot.cfg_ram_size = 128*1024;
@@ -129,15 +253,33 @@ int main(void)
     mcuboot_init(&mcuboot);
     
     FLASH_Init();
+#if (CHLIB_DMA_SUPPORT == 1)
+    /* the DMA keeps receiving during flash commands, the host may send ahead */
+    mcuboot.cfg_ack_before_write = 1;
+#elif (CHLIB_RAMFUNC_SUPPORT == 1)
+    FLASH_SetWaitHook(flash_wait_rx);
+    mcuboot.cfg_ack_before_write = 1;
+#endif
     SysTick_SetTime(100*1000);
     SysTick_SetIntMode(true);
     
     while(1)
     {
-        if(UART_GetChar(HW_UART0, &c) == CH_OK)
+#if (CHLIB_DMA_SUPPORT == 1)
+        if(pos == n)
+        {
+            n = UART_DMARecvRead(HW_UART0, buf, sizeof(buf));
+            pos = 0;
+        }
+        /* a chunk may hold the end of one frame and the start of the next, the decoder stops
+           after the first, the rest is passed again once mcuboot_proc has handled it */
+        pos += mcuboot_recv(&mcuboot, buf + pos, n - pos);
+#else
+        if(bl_getc(&c) == CH_OK)
         {
             mcuboot_recv(&mcuboot, &c, 1);
         }
+#endif
         
         if(timeout_jump == 1)
         {
@@ -14,17 +14,38 @@
 #include "flash.h"
 
 #include "mcuboot.h"
+#include "bl_mailbox.h"
+#include "bl_image.h"
 #include "bl_cfg.h"
 
 static uint8_t force_enter_bl = 0;
 static uint8_t timeout_jump = 0;
 static mcuboot_t mcuboot;
+#if (BL_IMAGE_CHECK == 1)
+static bl_image_t bl_image;
+
+/* raw page primitives of the verdict cache */
+static int flash_erase(uint32_t addr)
+{
+    return FLASH_ErasePage(addr);
+}
+
+static int flash_program(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    return FLASH_WriteSector(addr, buf, len);
+}
+#endif
 
 static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
 {
     int addr;
     addr = start_addr;
     
+#if (BL_IMAGE_CHECK == 1)
+    /* a download starts, the cached verdict no longer holds */
+    bl_image_invalidate(&bl_image);
+#endif
+    
     while(addr < (byte_cnt + start_addr))
     {
         FLASH_ErasePage(addr);
@@ -39,6 +60,10 @@ static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
     uint32_t page_addr;
     static ALIGN(64) uint8_t align_buf[64];
     
+#if (BL_IMAGE_CHECK == 1)
+    bl_image_invalidate(&bl_image);
+#endif
+    
     page_size = FLASH_GetPageSize();
     
     page_addr = ALIGN_DOWN(start_addr, page_size);
@@ -69,8 +94,8 @@ static int mcuboot_send(uint8_t *buf, uint32_t len)
 
 static void mcuboot_reset(void)
 {
-    /* delay for a while to wait mcuboot send respond packet */
-    DelayMs(100);
+    /* the response has left the shifter */
+    UART_WaitTxComplete(HW_UART0);
     NVIC_SystemReset();
 }
 
@@ -85,16 +110,22 @@ bool is_app_addr_validate(void)
     {
         return false;
     }
-    else
+#if (BL_IMAGE_CHECK == 1)
+    /* an interrupted or corrupted download fails the CRC */
+    if(bl_image_check(&bl_image, APPLICATION_BASE, NULL) != BL_IMAGE_OK)
     {
-        return true;
-    } 
+        return false;
+    }
+#endif
+    return true;
 }
 
 static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
 {
     if(is_app_addr_validate() == true)
     {
+        /* the Execute response leaves the line before the application takes the UART */
+        UART_WaitTxComplete(HW_UART0);
         /* clean up resouces */
         JumpToImage(addr);
     }
@@ -104,6 +135,33 @@ static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
 int main(void)
 {
     uint8_t c;
+#if (BL_IMAGE_CHECK == 1)
+    FLASH_Geometry_t geo;
+#endif
+    
+#if (BL_IMAGE_CHECK == 1)
+    /* ready before the first is_app_addr_validate, which may write the verdict */
+    FLASH_Init();
+    FLASH_GetGeometry(&geo);
+    bl_image.cfg_max_size = BL_IMAGE_CACHE_ADDR - APPLICATION_BASE;
+    bl_image.cfg_cache_addr = BL_IMAGE_CACHE_ADDR;
+    bl_image.cfg_cache_size = BL_IMAGE_CACHE_SIZE;
+    bl_image.cfg_erase_unit = geo.erase_unit;
+    bl_image.cfg_program_unit = geo.program_unit;
+    bl_image.op_erase = flash_erase;
+    bl_image.op_program = flash_program;
+    bl_image_init(&bl_image);
+#endif
+    
+    /* an update request from the application keeps the bootloader open, it is served once */
+    force_enter_bl = (bl_mailbox_take((bl_mailbox_t*)BL_MAILBOX_ADDR, NULL) == BL_MAILBOX_CMD_ENTER);
+#if (BL_FAST_BOOT == 1)
+    if((force_enter_bl == 0) && is_app_addr_validate())
+    {
+        JumpToImage(APPLICATION_BASE);
+    }
+#endif
+    
     SystemCoreClockUpdate();
     
     LPC_SYSCON->SYSAHBCLKCTRL |= (1<<7) | (1<<14) | (1<<18);
@@ -12,5 +12,56 @@
 /* Base address of user application */
 #define APPLICATION_BASE            (0x1800UL)
 #define BL_TIMEOUT_MS               (300)
-#define TARGET_FLASH_SIZE           (16*1024)
+/* physical flash size, the application region runs from APPLICATION_BASE up to its end */
+#define TARGET_FLASH_SIZE           (32*1024)
+
+/* 1: mcuboot runs over SPI0 in slave mode instead of UART0 */
+#ifndef BL_USE_SPI
+#define BL_USE_SPI                  (0)
+#endif
+
+/* SPI0 slave pins, SWM pin numbers: P0_n = n */
+#define BL_SPI_SCK_PIN              (9)
+#define BL_SPI_MOSI_PIN             (8)
+#define BL_SPI_MISO_PIN             (17)
+#define BL_SPI_SSEL_PIN             (13)
+
+/* ready output, high: the master may clock, low: IAP in progress, interrupts are masked */
+#define BL_SPI_READY_PIN            (15)
+
+/* 1: mcuboot runs over I2C0 in slave mode instead of UART0, no ready pin needed: SCL is stretched during IAP */
+#ifndef BL_USE_I2C
+#define BL_USE_I2C                  (0)
+#endif
+
+/* I2C0 slave address (7 bit) and pins, SWM pin numbers */
+#define BL_I2C_ADDR                 (0x10)
+#define BL_I2C_SDA_PIN              (14)
+#define BL_I2C_SCL_PIN              (7)
+
+/* 1: jump to a valid application at once, the listen window only opens on a mailbox request */
+#ifndef BL_FAST_BOOT
+#define BL_FAST_BOOT                (0)
+#endif
+
+/* 1: start only an image whose bl_image header (length, CRC32) matches, pc_tool/image_patch fills it in */
+#ifndef BL_IMAGE_CHECK
+#define BL_IMAGE_CHECK              (0)
+#endif
+
+/* the check result is cached in the last sector of the flash, the application region ends below it */
+#if (BL_IMAGE_CHECK == 1)
+#define BL_IMAGE_CACHE_SIZE         (1024)
+#else
+#define BL_IMAGE_CACHE_SIZE         (0)
+#endif
+#define BL_IMAGE_CACHE_ADDR         (TARGET_FLASH_SIZE - BL_IMAGE_CACHE_SIZE)
+
+/* 1: run at FRO 30MHz (core 15MHz) from the first host frame on, the reset clocks are restored before the jump */
+#ifndef BL_CLOCK_PROFILE
+#define BL_CLOCK_PROFILE            (0)
+#endif
+
+/* bl_mailbox_t shared with the application, the bootloader IRAM ends here */
+#define BL_MAILBOX_ADDR             (0x100007E0UL)
 #endif
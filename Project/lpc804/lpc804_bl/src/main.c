@@ -11,45 +11,84 @@
 #include "common.h"
 #include "gpio.h"
 #include "uart.h"
+#include "spi.h"
+#include "i2c.h"
 #include "flash.h"
+#include "syscon.h"
 
 #include "mcuboot.h"
+#include "mflash.h"
+#include "bl_mailbox.h"
+#include "bl_image.h"
 #include "bl_cfg.h"
 
+/* the application owns the flash from APPLICATION_BASE to the end, less the verdict cache */
+#define APP_REGION_SIZE     (TARGET_FLASH_SIZE - APPLICATION_BASE - BL_IMAGE_CACHE_SIZE)
+
 static uint8_t force_enter_bl = 0;
 static uint8_t timeout_jump = 0;
 static mcuboot_t mcuboot;
+static mflash_t mflash;
+#if (BL_IMAGE_CHECK == 1)
+static bl_image_t bl_image;
+#endif
 
-static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
+#if (BL_CLOCK_PROFILE == 1)
+static ClockProfile_t clock_saved;
+static uint8_t clock_entered = 0;
+#endif
+
+/* UART0, SPI0 or I2C0 receives from its interrupt into this ring */
+static uint8_t rx_ring[128];
+
+#if (BL_USE_SPI == 1)
+/* the SPI master owns the clock and cannot be paused by the slave, READY low tells it to wait */
+#define BL_READY(x)     GPIO_PinWrite(HW_GPIO0, BL_SPI_READY_PIN, (x))
+#else
+#define BL_READY(x)
+#endif
+
+/* raw flash primitives, alignment and merging is done by mflash */
+static int flash_erase(uint32_t addr)
 {
-    int addr;
-    addr = start_addr;
+    int ret;
     
-    while(addr < (byte_cnt + start_addr))
-    {
-        FLASH_ErasePage(addr);
-        addr += FLASH_GetPageSize();
-    }
-    return 0;
+    BL_READY(0);
+    ret = FLASH_ErasePage(addr);
+    BL_READY(1);
+    return ret;
 }
 
-static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
+static int flash_program(uint32_t addr, const uint8_t *buf, uint32_t len)
 {
-    uint32_t page_size;
-    uint32_t page_addr;
-    static ALIGN(64) uint8_t align_buf[64];
+    int ret;
     
-    page_size = FLASH_GetPageSize();
-    
-    page_addr = ALIGN_DOWN(start_addr, page_size);
-    
-    memcpy(align_buf, (uint8_t*)page_addr, page_size);
-    memcpy(align_buf + start_addr - page_addr, buf, byte_cnt);
-    
-    FLASH_WritePage(page_addr, align_buf);
+    BL_READY(0);
+    ret = FLASH_WriteSector(addr, buf, len);
+    BL_READY(1);
+    return ret;
+}
 
-    
-    return 0;
+static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
+{
+#if (BL_IMAGE_CHECK == 1)
+    /* a download starts, the cached verdict no longer holds */
+    bl_image_invalidate(&bl_image);
+#endif
+    return mflash_erase(&mflash, start_addr, byte_cnt);
+}
+
+static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
+{
+#if (BL_IMAGE_CHECK == 1)
+    bl_image_invalidate(&bl_image);
+#endif
+    return mflash_write(&mflash, start_addr, buf, byte_cnt);
+}
+
+static int memory_flush(void)
+{
+    return mflash_flush(&mflash);
 }
 
 int memory_read(uint32_t addr, uint8_t *buf, uint32_t len)
@@ -58,37 +97,101 @@ int memory_read(uint32_t addr, uint8_t *buf, uint32_t len)
     return 0;
 }
 
+#if (BL_USE_SPI == 1)
+/* clocked out by the master, mcuboot waits on mcuboot_send_is_busy before reusing buf */
 static int mcuboot_send(uint8_t *buf, uint32_t len)
 {
-    while(len--)
-    {
-        UART_PutChar(HW_UART0, *buf++);
-    }
-    return 0;
+    return SPI_SlaveWriteAsync(HW_SPI0, buf, len);
 }
 
+static int mcuboot_send_is_busy(void)
+{
+    return SPI_SlaveIsTxBusy(HW_SPI0);
+}
+
+static uint32_t bl_read(uint8_t *buf, uint32_t max)
+{
+    return SPI_SlaveRead(HW_SPI0, buf, max);
+}
+#elif (BL_USE_I2C == 1)
+/* read by the master, mcuboot waits on mcuboot_send_is_busy before reusing buf */
+static int mcuboot_send(uint8_t *buf, uint32_t len)
+{
+    return I2C_SlaveWriteAsync(HW_I2C0, buf, len);
+}
+
+static int mcuboot_send_is_busy(void)
+{
+    return I2C_SlaveIsTxBusy(HW_I2C0);
+}
+
+static uint32_t bl_read(uint8_t *buf, uint32_t max)
+{
+    return I2C_SlaveRead(HW_I2C0, buf, max);
+}
+#else
+/* sent from the TXRDY interrupt, mcuboot waits on mcuboot_send_is_busy before reusing buf */
+static int mcuboot_send(uint8_t *buf, uint32_t len)
+{
+    return UART_WriteAsync(HW_UART0, buf, len);
+}
+
+static int mcuboot_send_is_busy(void)
+{
+    return UART_IsTxBusy(HW_UART0);
+}
+
+static uint32_t bl_read(uint8_t *buf, uint32_t max)
+{
+    return UART_Read(HW_UART0, buf, max);
+}
+#endif
+
 static void mcuboot_reset(void)
 {
-    /* delay for a while to wait mcuboot send respond packet */
+#if (BL_USE_SPI == 1) || (BL_USE_I2C == 1)
+    /* the master clocks the response out, give it time to read it */
     DelayMs(100);
+#else
+    /* the response has left the shifter */
+    UART_WaitTxComplete(HW_UART0);
+#endif
     NVIC_SystemReset();
 }
 
 static void mcuboot_complete(void) {}
 
+#if (BL_CLOCK_PROFILE == 1)
+/* the host waits for the answer to its first frame. UART0, the flash CCLK and the delays follow the core clock */
+static void mcuboot_connect(void)
+{
+    if(ClockProfileEnter(&clock_saved) == CH_OK)
+    {
+        clock_entered = 1;
+        DelayInit();
+        UART_SetBaudRate(HW_UART0, 115200);
+        FLASH_Init();
+    }
+}
+#endif
+
 bool is_app_addr_validate(void)
 {
     uint32_t *vectorTable = (uint32_t*)APPLICATION_BASE;
     uint32_t pc = vectorTable[1];
     
-    if (pc < APPLICATION_BASE || pc > TARGET_FLASH_SIZE)
+    if (pc < APPLICATION_BASE || pc > (APPLICATION_BASE + APP_REGION_SIZE))
     {
         return false;
     }
-    else
+#if (BL_IMAGE_CHECK == 1)
+    /* an interrupted or corrupted download fails the CRC */
+    if(bl_image_check(&bl_image, APPLICATION_BASE, NULL) != BL_IMAGE_OK)
     {
-        return true;
-    } 
+        return false;
+    }
+#endif
+    return true;
 }
 
 static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
@@ -96,6 +199,28 @@ static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
     if(is_app_addr_validate() == true)
     {
         /* clean up resouces */
+#if (BL_USE_SPI == 1)
+        BL_READY(0);
+        NVIC_DisableIRQ(SPI0_IRQn);
+        LPC_SPI0->INTENCLR = 0xFFFFFFFF;
+        LPC_SPI0->CFG = 0;
+#elif (BL_USE_I2C == 1)
+        NVIC_DisableIRQ(I2C0_IRQn);
+        LPC_I2C0->INTENCLR = 0xFFFFFFFF;
+        LPC_I2C0->CFG = 0;
+#else
+        /* the Execute response leaves the line before the application takes the UART */
+        UART_WaitTxComplete(HW_UART0);
+        UART_SetIntMode(HW_UART0, kUART_IntRx, false);
+        NVIC_DisableIRQ(UART0_IRQn);
+#endif
+#if (BL_CLOCK_PROFILE == 1)
+        /* the application starts with the clocks of a reset */
+        if(clock_entered)
+        {
+            ClockProfileExit(&clock_saved);
+        }
+#endif
         JumpToImage(addr);
     }
 }
@@ -103,7 +228,33 @@ static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp)
 
 int main(void)
 {
-    uint8_t c;
+    uint8_t buf[32];
+    uint32_t n = 0, pos = 0;
+    FLASH_Geometry_t geo;
+    
+#if (BL_IMAGE_CHECK == 1)
+    /* ready before the first is_app_addr_validate, which may write the verdict */
+    FLASH_Init();
+    FLASH_GetGeometry(&geo);
+    bl_image.cfg_max_size = BL_IMAGE_CACHE_ADDR - APPLICATION_BASE;
+    bl_image.cfg_cache_addr = BL_IMAGE_CACHE_ADDR;
+    bl_image.cfg_cache_size = BL_IMAGE_CACHE_SIZE;
+    bl_image.cfg_erase_unit = geo.erase_unit;
+    bl_image.cfg_program_unit = geo.program_unit;
+    bl_image.op_erase = flash_erase;
+    bl_image.op_program = flash_program;
+    bl_image_init(&bl_image);
+#endif
+    
+    /* an update request from the application keeps the bootloader open, it is served once */
+    force_enter_bl = (bl_mailbox_take((bl_mailbox_t*)BL_MAILBOX_ADDR, NULL) == BL_MAILBOX_CMD_ENTER);
+#if (BL_FAST_BOOT == 1)
+    if((force_enter_bl == 0) && is_app_addr_validate())
+    {
+        JumpToImage(APPLICATION_BASE);
+    }
+#endif
+    
     SystemCoreClockUpdate();
     
     LPC_SYSCON->SYSAHBCLKCTRL0 |= (1<<7) | (1<<14) | (1<<18);
@@ -117,22 +268,59 @@ int main(void)
    
     UART_Init(HW_UART0, 115200);
     
+#if (BL_USE_SPI == 1)
+    /* SPI0 slave: SCK, MOSI, MISO, SSEL, mode 0 */
+    SWM_Config(3, BL_SPI_SCK_PIN, 24);
+    SWM_Config(4, BL_SPI_MOSI_PIN, 0);
+    SWM_Config(4, BL_SPI_MISO_PIN, 8);
+    SWM_Config(4, BL_SPI_SSEL_PIN, 16);
+    SPI_SlaveInit(HW_SPI0, rx_ring, sizeof(rx_ring));
+    
+    GPIO_Init(HW_GPIO0, BL_SPI_READY_PIN, kGPIO_OPPH);
+    BL_READY(1);
+#elif (BL_USE_I2C == 1)
+    /* I2C0 slave: PINASSIGN5 I2C0_SDA 15:8, I2C0_SCL 23:16 */
+    SWM_Config(5, BL_I2C_SDA_PIN, 8);
+    SWM_Config(5, BL_I2C_SCL_PIN, 16);
+    I2C_SlaveInit(HW_I2C0, BL_I2C_ADDR, rx_ring, sizeof(rx_ring));
+#else
+    UART_EnableRxRing(HW_UART0, rx_ring, sizeof(rx_ring));
+#endif
+    
     LIB_TRACE("CoreClock:%dHz\r\n", GetClock(kCoreClock));
 
     FLASH_Init();
     
+    /* config the flash engine from the driver geometry */
+    FLASH_GetGeometry(&geo);
+    mflash.cfg_start = APPLICATION_BASE;
+    mflash.cfg_size = APP_REGION_SIZE;
+    mflash.cfg_erase_unit = geo.erase_unit;
+    mflash.cfg_program_unit = geo.program_unit;
+    mflash.cfg_erase_time_us = geo.erase_time_us;
+    mflash.cfg_program_time_us = geo.program_time_us;
+    mflash.cfg_block_size = geo.block_size;
+    mflash.op_erase = flash_erase;
+    mflash.op_program = flash_program;
+    mflash_init(&mflash);
+    
     /* config the mcuboot */
     mcuboot.op_send = mcuboot_send;
+    mcuboot.op_send_is_busy = mcuboot_send_is_busy;
     mcuboot.op_reset = mcuboot_reset;
     mcuboot.op_jump = mcuboot_jump;
     mcuboot.op_complete = mcuboot_complete;
+#if (BL_CLOCK_PROFILE == 1)
+    mcuboot.op_connect = mcuboot_connect;
+#endif
     
     mcuboot.op_mem_erase = memory_erase;
     mcuboot.op_mem_write = memory_write;
     mcuboot.op_mem_read = memory_read;
+    mcuboot.op_mem_flush = memory_flush;
     
     mcuboot.cfg_flash_start = APPLICATION_BASE;
-    mcuboot.cfg_flash_size = TARGET_FLASH_SIZE;
+    mcuboot.cfg_flash_size = APP_REGION_SIZE;
     mcuboot.cfg_flash_sector_size = 64;
     mcuboot.cfg_ram_start = 0x10000000;
     mcuboot.cfg_ram_size = 2*1024;
@@ -146,10 +334,14 @@ int main(void)
     
     while(1)
     {
-        if(UART_GetChar(HW_UART0, &c) == CH_OK)
+        if(pos == n)
         {
-            mcuboot_recv(&mcuboot, &c, 1);
+            n = bl_read(buf, sizeof(buf));
+            pos = 0;
         }
+        /* a chunk may hold the end of one frame and the start of the next, the decoder stops
+           after the first, the rest is passed again once mcuboot_proc has handled it */
+        pos += mcuboot_recv(&mcuboot, buf + pos, n - pos);
         
         if(timeout_jump == 1)
         {
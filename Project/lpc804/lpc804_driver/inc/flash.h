@@ -9,13 +9,25 @@
 
 #include <stdint.h>
 
+/* flash geometry, times are typical values from the datasheet */
+typedef struct
+{
+    uint32_t erase_unit;        /* bytes erased by FLASH_ErasePage */
+    uint32_t program_unit;      /* smallest length FLASH_WriteSector programs */
+    uint32_t erase_time_us;
+    uint32_t program_time_us;   /* per program unit */
+    uint32_t block_size;        /* bytes erased by FLASH_EraseBlock, 0: no block erase */
+}FLASH_Geometry_t;
+
 
 //!< API 
 void FLASH_Init(void);
 uint32_t FLASH_GetSectorSize(void);
 uint32_t FLASH_GetPageSize(void);
+void FLASH_GetGeometry(FLASH_Geometry_t *geo);
 uint8_t FLASH_ErasePage(uint32_t addr);
 uint8_t FLASH_WritePage(uint32_t addr, const uint8_t *buf);
+uint8_t FLASH_WriteSector(uint32_t addr, const uint8_t *buf, uint32_t len);
 uint8_t FLASH_EraseSector(uint32_t addr);
 uint32_t FLASH_Test(uint32_t startAddr, uint32_t len);
 uint32_t ISP_GetUID(void);
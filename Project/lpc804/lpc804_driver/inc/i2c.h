@@ -21,6 +21,13 @@ typedef enum
     kI2C_SlvDesel,
 }I2C_Int_t;
 
+/* slave transport counters, see I2C_SlaveGetStat */
+typedef struct
+{
+    uint32_t ring_full;         /* times SCL was held because the receive ring was full */
+    uint32_t tx_fill;           /* filler bytes returned because nothing was queued */
+}I2C_SlaveStat_t;
+
 #define HW_I2C0     (0)
 #define HW_I2C1     (1)
 #define HW_I2C2     (2)
@@ -37,5 +44,11 @@ uint32_t I2C_Probe(uint32_t instance, uint8_t addr);
 void I2C_Scan(uint32_t instance);
 uint32_t I2C_SetIntMode(uint32_t instance, I2C_Int_t mode, bool val);
 uint32_t I2C_SetSlvAddr(uint32_t instance, uint32_t slot, uint32_t addr);
+uint32_t I2C_SlaveInit(uint32_t instance, uint8_t addr, uint8_t *buf, uint32_t size);
+uint32_t I2C_SlaveRead(uint32_t instance, uint8_t *buf, uint32_t max);
+uint32_t I2C_SlaveWriteAsync(uint32_t instance, const uint8_t *buf, uint32_t len);
+bool I2C_SlaveIsTxBusy(uint32_t instance);
+void I2C_SlaveGetStat(uint32_t instance, I2C_SlaveStat_t *stat);
+void I2C_IRQHandler(uint32_t instance);
 
 #endif
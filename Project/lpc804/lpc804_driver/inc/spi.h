@@ -22,11 +22,25 @@
 #include <stdbool.h>
      
 
+/* slave transport loss counters, see SPI_SlaveGetStat */
+typedef struct
+{
+    uint32_t rx_overrun;        /* RXDAT was not read before the next byte */
+    uint32_t tx_underrun;       /* TXDAT was not written before the master clocked */
+    uint32_t ring_overrun;      /* bytes dropped because the receive ring was full */
+}SPI_SlaveStat_t;
+
 uint32_t SPI_Init(uint32_t MAP, uint32_t baudrate);     
 uint32_t SPI_ReadWriteEx(uint32_t instance, uint32_t data, uint16_t cs, uint32_t cs_state);
 uint32_t SPI_ReadWrite(uint32_t instance, uint32_t data);
 uint32_t SPI_WriteFIFO(uint32_t instance, uint8_t *buf, uint32_t len);
 uint32_t SPI_ReadFIFO(uint32_t instance, uint8_t *buf, uint32_t len);
 uint32_t SPI_ReadWriteFIFO(uint32_t instance, uint8_t *in_buf, uint8_t *out_buf, uint32_t len);
+uint32_t SPI_SlaveInit(uint32_t instance, uint8_t *buf, uint32_t size);
+uint32_t SPI_SlaveRead(uint32_t instance, uint8_t *buf, uint32_t max);
+uint32_t SPI_SlaveWriteAsync(uint32_t instance, const uint8_t *buf, uint32_t len);
+bool SPI_SlaveIsTxBusy(uint32_t instance);
+void SPI_SlaveGetStat(uint32_t instance, SPI_SlaveStat_t *stat);
+void SPI_IRQHandler(uint32_t instance);
 
 #endif
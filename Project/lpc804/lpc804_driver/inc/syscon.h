@@ -12,6 +12,16 @@
 
 uint32_t SetupSystemPLL(uint8_t input_src, uint32_t in_clk, uint32_t out_clk);
 
+/* clock state before ClockProfileEnter */
+typedef struct
+{
+    uint32_t fro_khz;
+    uint32_t core_clock;
+}ClockProfile_t;
+
+uint32_t ClockProfileEnter(ClockProfile_t *saved);
+void ClockProfileExit(const ClockProfile_t *saved);
+
 
 #endif
 
@@ -28,12 +28,25 @@ typedef enum
 }UART_Int_t;
 
 
+/* receive loss counters, see UART_GetRxStat */
+typedef struct
+{
+    uint32_t hw_overrun;        /* receiver overrun, RXDAT was not read in time */
+    uint32_t ring_overrun;      /* bytes dropped because the receive ring was full */
+}UART_RxStat_t;
+
 /* API */
 uint32_t UART_Init(uint32_t instance, uint32_t baudrate);
 void UART_SetBaudRate(uint32_t instance, uint32_t baud);
 uint32_t UART_GetChar(uint32_t instance, uint8_t *ch);
 void UART_PutChar(uint32_t instance, uint8_t ch);
 uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val);
+uint32_t UART_EnableRxRing(uint32_t instance, uint8_t *buf, uint32_t size);
+uint32_t UART_Read(uint32_t instance, uint8_t *buf, uint32_t max);
+void UART_GetRxStat(uint32_t instance, UART_RxStat_t *stat);
+uint32_t UART_WriteAsync(uint32_t instance, const uint8_t *buf, uint32_t len);
+bool UART_IsTxBusy(uint32_t instance);
+void UART_WaitTxComplete(uint32_t instance);
 
 
 #ifdef __cplusplus
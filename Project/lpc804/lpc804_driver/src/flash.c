@@ -30,6 +30,20 @@ typedef void (*IAP_Entry) (unsigned long *cmd, unsigned long *stat);
 #define PAGE_SIZE           (64)
 #define SECTOR_SIZE         (1*1024)
 
+/* typical page erase and page program time */
+#define ERASE_TIME_US       (5000)
+#define PROGRAM_TIME_US     (1000)
+
+/* flash can not be read while IAP erases or programs it, so no vector fetch or ISR may run */
+static void iap_call(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    
+    __disable_irq();
+    IAP_Call (&IAP.cmd, &IAP.stat);
+    __set_PRIMASK(primask);
+}
+
 unsigned long GetSecNum (unsigned long adr)
 {
     unsigned long n;
@@ -54,6 +68,20 @@ uint32_t FLASH_GetPageSize(void)
     return PAGE_SIZE;
 }
 
+ /**
+ * @brief  get erase/program unit and typical command time
+ * @param  geo: filled by this function
+ * @retval None
+ */
+void FLASH_GetGeometry(FLASH_Geometry_t *geo)
+{
+    geo->erase_unit = PAGE_SIZE;
+    geo->program_unit = PAGE_SIZE;
+    geo->erase_time_us = ERASE_TIME_US;
+    geo->program_time_us = PROGRAM_TIME_US;
+    geo->block_size = 0;
+}
+
  /**
  * @brief  Flash
  * @note   None
@@ -80,18 +108,14 @@ uint8_t FLASH_EraseSector(uint32_t addr)
     IAP.cmd    = 50;                             // Prepare Sector for Erase
     IAP.par[0] = n;                              // Start Sector
     IAP.par[1] = n;                              // End Sector
-   // __disable_irq();
-    IAP_Call (&IAP.cmd, &IAP.stat);              // Call IAP Command
-  //  __enable_irq();
+    iap_call();                                  // Call IAP Command
     if (IAP.stat) return (1);                    // Command Failed
 
     IAP.cmd    = 52;                             // Erase Sector
     IAP.par[0] = n;                              // Start Sector
     IAP.par[1] = n;                              // End Sector
     IAP.par[2] = CCLK;                           // CCLK in kHz
-   // __disable_irq();
-    IAP_Call (&IAP.cmd, &IAP.stat);              // Call IAP Command
-//    __enable_irq();
+    iap_call();                                  // Call IAP Command
     if (IAP.stat) return (1);                    // Command Failed
 
     return (0);                                  // Finished without Errors
@@ -132,9 +156,7 @@ uint8_t FLASH_ErasePage(uint32_t addr)
     IAP.cmd    = 50;                             // Prepare Sector for Erase
     IAP.par[0] = n;                              // Start Sector
     IAP.par[1] = n;                              // End Sector
-  //  __disable_irq();
-    IAP_Call (&IAP.cmd, &IAP.stat);              // Call IAP Command
-  //  __enable_irq();
+    iap_call();                                  // Call IAP Command
     if (IAP.stat) return (1);                    // Command Failed
     
     page = addr/PAGE_SIZE;
@@ -143,24 +165,14 @@ uint8_t FLASH_ErasePage(uint32_t addr)
     IAP.par[0] = page;
     IAP.par[1] = page;
     IAP.par[2] = CCLK;
- //   __disable_irq();
-    IAP_Call (&IAP.cmd, &IAP.stat);
-   // __enable_irq();
+    iap_call();
     if (IAP.stat) return (1);
 
     return (0);
 }
 
 
- /**
- * @brief  write a flash page
- * @note   
- * @param  addr: start address, must be align with 256 bytes
- * @param  buf : buf pointer
- * @param  len : len of buffer
- * @retval CH_OK or CH_ERR
- */
-uint8_t FLASH_WritePage(uint32_t addr, const uint8_t *buf)
+static uint8_t _write(uint32_t addr, const uint8_t *buf, uint32_t len)
 {
     unsigned long n;
 
@@ -182,24 +194,67 @@ uint8_t FLASH_WritePage(uint32_t addr, const uint8_t *buf)
     IAP.cmd    = 50;                             // Prepare Sector for Write
     IAP.par[0] = n;                              // Start Sector
     IAP.par[1] = n;                              // End Sector
-  //  __disable_irq();
-    IAP_Call (&IAP.cmd, &IAP.stat);              // Call IAP Command
-  //  __enable_irq();
+    iap_call();                                  // Call IAP Command
     if (IAP.stat) return (1);                    // Command Failed
 
     IAP.cmd    = 51;                             // Copy RAM to Flash
     IAP.par[0] = addr;                            // Destination Flash Address
     IAP.par[1] = (unsigned long)buf;             // Source RAM Address
-    IAP.par[2] = PAGE_SIZE;                 // Fixed Page Size
+    IAP.par[2] = len;                            // 64 | 128 | 256 | 512 | 1024
     IAP.par[3] = CCLK;                           // CCLK in kHz
-  //  __disable_irq();
-    IAP_Call (&IAP.cmd, &IAP.stat);              // Call IAP Command
-  //  __enable_irq();
+    iap_call();                                  // Call IAP Command
     if (IAP.stat) return (1);                    // Command Failed
 
     return CH_OK;
 }
 
+ /**
+ * @brief  write a flash page
+ * @note   
+ * @param  addr: start address, must be align with 256 bytes
+ * @param  buf : buf pointer
+ * @param  len : len of buffer
+ * @retval CH_OK or CH_ERR
+ */
+uint8_t FLASH_WritePage(uint32_t addr, const uint8_t *buf)
+{
+    return _write(addr, buf, PAGE_SIZE);
+}
+
+ /**
+ * @brief  write whole pages
+ * @note   consecutive pages of one sector are copied by one IAP call
+ * @param  addr: start address, must be align with page size
+ * @param  buf : buf pointer, must be word aligned
+ * @param  len : len of buffer, multiple of page size
+ * @retval CH_OK or CH_ERR, CH_ERR without writing when addr or len is not page aligned
+ */
+uint8_t FLASH_WriteSector(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    uint32_t n;
+
+    /* a page is the smallest IAP copy, the halving below stops there */
+    if((addr | len) & (PAGE_SIZE - 1))
+    {
+        return CH_ERR;
+    }
+    while(len)
+    {
+        /* largest IAP copy size which keeps alignment and stays in the sector */
+        n = SECTOR_SIZE;
+        while((n > len) || (addr & (n - 1)))
+        {
+            n >>= 1;
+        }
+
+        if(_write(addr, buf, n)) return CH_ERR;
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+    return CH_OK;
+}
+
 static uint32_t FLASH_PageTest(uint32_t addr)
 {
     int i;
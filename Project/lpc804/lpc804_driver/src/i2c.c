@@ -32,9 +32,45 @@
 #define GET_MACHINE_CODE(x) ((x & I2C_STAT_MSTSTATE_MASK) >> I2C_STAT_MSTSTATE_SHIFT)
 #define STAT_MSTPEND  		(1 << 0)
 
+#define I2C_STAT_SLVPENDING_MASK                 (0x100U)
+#define I2C_STAT_SLVSTATE_MASK                   (0x600U)
+#define I2C_STAT_SLVSTATE_SHIFT                  (9U)
+#define I2C_SLVCTL_SLVCONTINUE_MASK              (0x1U)
+
 #define LPC_I2C0_Type   LPC_I2C_TypeDef
 
+#if defined(LPC_I2C1)
 static LPC_I2C0_Type* const I2CBases[] = {LPC_I2C0, LPC_I2C1};
+#else
+static LPC_I2C0_Type* const I2CBases[] = {LPC_I2C0};
+#endif
+
+/* slave transport: RX ring and TX buffer serviced from the SLVPENDING interrupt */
+typedef struct
+{
+    volatile uint8_t *buf;
+    uint32_t mask;
+    volatile uint32_t in;
+    volatile uint32_t out;
+    volatile uint32_t paused;
+    const uint8_t * volatile tx_buf;
+    volatile uint32_t tx_len;
+    I2C_SlaveStat_t stat;
+}I2C_Slave_t;
+
+static I2C_Slave_t I2C_Slave[ARRAY_SIZE(I2CBases)];
+
+/* returned when the master reads and nothing is queued, kptl_decode skips it */
+#define I2C_SLAVE_FILL              (0x00)
+
+static void _I2C_EnableClock(uint32_t instance)
+{
+#if defined(LPC82X)
+    LPC_SYSCON->SYSAHBCLKCTRL |= (1<<5);
+#else
+    LPC_SYSCON->SYSAHBCLKCTRL0 |= (1<<5);
+#endif
+}
 
 
 void I2C_SetBaudRate(uint32_t instance, uint32_t baud)
@@ -280,7 +316,7 @@ uint32_t I2C_WriteReg(uint32_t instance, uint8_t addr, uint8_t regAddr, uint8_t
 
 uint32_t I2C_Init(uint32_t MAP, uint32_t baudrate)
 {
-    LPC_SYSCON->SYSAHBCLKCTRL |= (1<<5);
+    _I2C_EnableClock(MAP);
     
     I2C_SetBaudRate(MAP, baudrate);
     
@@ -377,3 +413,157 @@ void I2C_Scan(uint32_t instance)
     }
 }
 
+/**
+ * @brief  start I2C slave mode on address slot 0
+ * @note   bytes written by the master go to a ring read by I2C_SlaveRead, bytes read by the
+ *         master come from I2C_SlaveWriteAsync. SCL is stretched as long as SLVPENDING is not
+ *         serviced: while interrupts are masked (e.g. during IAP) and while the ring is full,
+ *         so no byte is ever lost. The slave runs from the undivided I2C function clock, which
+ *         must be at least 8 times the bus rate, e.g. >= 8MHz for Fast-mode Plus (1MHz)
+ * @param  instance: HW_I2C0
+ * @param  addr: 7 bit slave address
+ * @param  buf: ring storage, must stay valid
+ * @param  size: power of 2
+ * @retval CH_OK or CH_ERR
+ */
+uint32_t I2C_SlaveInit(uint32_t instance, uint8_t addr, uint8_t *buf, uint32_t size)
+{
+    I2C_Slave_t *sl = &I2C_Slave[instance];
+    LPC_I2C0_Type *I2Cx = I2CBases[instance];
+    
+    if((size == 0) || (size & (size - 1)))
+    {
+        return CH_ERR;
+    }
+    
+    _I2C_EnableClock(instance);
+    #if defined(LPC802)
+    LPC_SYSCON->I2C0CLKSEL = 1;
+    #endif
+    
+    sl->mask = size - 1;
+    sl->in = 0;
+    sl->out = 0;
+    sl->paused = 0;
+    sl->tx_len = 0;
+    sl->buf = buf;
+    
+    I2Cx->CFG = 0;
+    I2Cx->DIV = 0;
+    I2C_SetSlvAddr(instance, 0, addr);
+    
+    /* slave enable only */
+    I2Cx->CFG = (1<<1);
+    I2C_SetIntMode(instance, kI2C_SlvPending, true);
+    return CH_OK;
+}
+
+/**
+ * @brief  read up to max received bytes, releases SCL if the ring was full
+ * @param  instance: HW_I2C0
+ * @param  buf: destination
+ * @param  max: size of buf
+ * @retval number of bytes read, 0 if none
+ */
+uint32_t I2C_SlaveRead(uint32_t instance, uint8_t *buf, uint32_t max)
+{
+    I2C_Slave_t *sl = &I2C_Slave[instance];
+    uint32_t out = sl->out;
+    uint32_t n = 0;
+    
+    while((n < max) && (out != sl->in))
+    {
+        buf[n++] = sl->buf[out & sl->mask];
+        out++;
+    }
+    sl->out = out;
+    
+    /* SLVPENDING is still set, the interrupt fires at once and takes the stretched byte */
+    if(sl->paused && n)
+    {
+        sl->paused = 0;
+        I2CBases[instance]->INTENSET = I2C_STAT_SLVPENDING_MASK;
+    }
+    return n;
+}
+
+/**
+ * @brief  queue a buffer for the master to read
+ * @note   buf must stay untouched until I2C_SlaveIsTxBusy returns false
+ * @param  instance: HW_I2C0
+ * @param  buf: data
+ * @param  len: length in bytes
+ * @retval CH_OK or CH_ERR if the previous buffer is still queued
+ */
+uint32_t I2C_SlaveWriteAsync(uint32_t instance, const uint8_t *buf, uint32_t len)
+{
+    I2C_Slave_t *sl = &I2C_Slave[instance];
+    
+    if(sl->tx_len)
+    {
+        return CH_ERR;
+    }
+    sl->tx_buf = buf;
+    sl->tx_len = len;
+    return CH_OK;
+}
+
+bool I2C_SlaveIsTxBusy(uint32_t instance)
+{
+    return (I2C_Slave[instance].tx_len != 0);
+}
+
+void I2C_SlaveGetStat(uint32_t instance, I2C_SlaveStat_t *stat)
+{
+    *stat = I2C_Slave[instance].stat;
+}
+
+void I2C_IRQHandler(uint32_t instance)
+{
+    LPC_I2C0_Type *I2Cx = I2CBases[instance];
+    I2C_Slave_t *sl = &I2C_Slave[instance];
+    uint32_t stat = I2Cx->STAT;
+    uint32_t in;
+    
+    if((stat & I2C_STAT_SLVPENDING_MASK) == 0)
+    {
+        return;
+    }
+    
+    switch((stat & I2C_STAT_SLVSTATE_MASK) >> I2C_STAT_SLVSTATE_SHIFT)
+    {
+        case 0: /* address match, ack it */
+            break;
+        case 1: /* master wrote a byte */
+            in = sl->in;
+            if((in - sl->out) > sl->mask)
+            {
+                /* ring full: keep SCL low until I2C_SlaveRead made room */
+                I2Cx->INTENCLR = I2C_STAT_SLVPENDING_MASK;
+                sl->paused = 1;
+                sl->stat.ring_full++;
+                return;
+            }
+            sl->buf[in & sl->mask] = (uint8_t)I2Cx->SLVDAT;
+            sl->in = in + 1;
+            break;
+        case 2: /* master reads a byte */
+            if(sl->tx_len)
+            {
+                I2Cx->SLVDAT = *sl->tx_buf++;
+                sl->tx_len--;
+            }
+            else
+            {
+                I2Cx->SLVDAT = I2C_SLAVE_FILL;
+                sl->stat.tx_fill++;
+            }
+            break;
+    }
+    I2Cx->SLVCTL = I2C_SLVCTL_SLVCONTINUE_MASK;
+}
+
+void I2C0_IRQHandler(void)
+{
+    I2C_IRQHandler(HW_I2C0);
+}
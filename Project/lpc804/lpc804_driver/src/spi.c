@@ -8,7 +8,11 @@
 #include "spi.h"
 
 
+#if defined(LPC_SPI1)
 LPC_SPI_TypeDef* const SPIBases[] = {LPC_SPI0, LPC_SPI1};
+#else
+LPC_SPI_TypeDef* const SPIBases[] = {LPC_SPI0};
+#endif
 
 #define SPI_STAT_BITMASK            (0x1FF)					/** SPI STAT Register BitMask */
 #define SPI_STAT_RXRDY              (1 << 0)				/** Receiver Ready Flag */
@@ -25,12 +29,39 @@ LPC_SPI_TypeDef* const SPIBases[] = {LPC_SPI0, LPC_SPI1};
 #define SPI_DEASSERTNUM_SSEL(n) (1U << ((n) + 16))
 #define SPI_DEASSERT_ALL (0xF0000)
 
+/* slave transport: RX ring and TX buffer serviced from the RXRDY interrupt, one interrupt per byte */
+typedef struct
+{
+    volatile uint8_t *buf;
+    uint32_t mask;
+    volatile uint32_t in;
+    volatile uint32_t out;
+    const uint8_t * volatile tx_buf;
+    volatile uint32_t tx_len;
+    SPI_SlaveStat_t stat;
+}SPI_Slave_t;
+
+static SPI_Slave_t SPI_Slave[ARRAY_SIZE(SPIBases)];
+
+/* clocked out when the slave has nothing to send, kptl_decode skips it */
+#define SPI_SLAVE_FILL              (0x00)
+
+static void _SPI_EnableClock(uint32_t instance)
+{
+#if defined(LPC82X)
+    LPC_SYSCON->SYSAHBCLKCTRL |= (1<<11) | (1<<12);
+#else
+    LPC_SYSCON->SYSAHBCLKCTRL0 |= (1<<11);
+    LPC_SYSCON->SPI0CLKSEL = 0x01;      /* main clock */
+#endif
+}
+
 uint32_t SPI_Init(uint32_t instance, uint32_t baudrate)
 {
     int div;
     
     /* enable uart clock */
-    LPC_SYSCON->SYSAHBCLKCTRL |= (1<<11) | (1<<12);
+    _SPI_EnableClock(instance);
     
     SPIBases[instance]->CFG = 0x00;
     div = (GetClock(kCoreClock) / baudrate) - 1;
@@ -92,5 +123,146 @@ uint32_t SPI_ReadWrite(uint32_t instance, uint32_t data)
     return SPI_ReadWriteEx(instance, data, 0, 1);
 }
 
+/**
+ * @brief  start SPI slave mode, 8 bit frames, CPOL = CPHA = 0
+ * @note   received bytes go to a ring read by SPI_SlaveRead, SPI_SlaveWriteAsync queues the
+ *         bytes clocked out next; each byte is serviced by one RXRDY interrupt, so one byte
+ *         time must be longer than the interrupt latency, and the master must stop clocking
+ *         while interrupts are masked (e.g. during IAP), see the ready pin of the bootloader
+ * @param  instance: HW_SPI0
+ * @param  buf: ring storage, must stay valid
+ * @param  size: power of 2
+ * @retval CH_OK or CH_ERR
+ */
+uint32_t SPI_SlaveInit(uint32_t instance, uint8_t *buf, uint32_t size)
+{
+    SPI_Slave_t *sl = &SPI_Slave[instance];
+    LPC_SPI_TypeDef *SPIx = SPIBases[instance];
+    
+    if((size == 0) || (size & (size - 1)))
+    {
+        return CH_ERR;
+    }
+    
+    _SPI_EnableClock(instance);
+    
+    sl->mask = size - 1;
+    sl->in = 0;
+    sl->out = 0;
+    sl->tx_len = 0;
+    sl->buf = buf;
+    
+    SPIx->CFG = 0x00;
+    SPIx->STAT = SPI_STAT_BITMASK;
+    
+    /* 8 bit frame */
+    SPIx->TXCTL = (0x07<<24);
+    
+    /* enable SPI in slave mode, first byte out is the filler */
+    SPIx->CFG = (1<<0);
+    SPIx->TXDAT = SPI_SLAVE_FILL;
+    
+    SPIx->INTENSET = SPI_STAT_RXRDY;
+    NVIC_EnableIRQ(SPI0_IRQn);
+    return CH_OK;
+}
 
+/**
+ * @brief  read up to max received bytes
+ * @param  instance: HW_SPI0
+ * @param  buf: destination
+ * @param  max: size of buf
+ * @retval number of bytes read, 0 if none
+ */
+uint32_t SPI_SlaveRead(uint32_t instance, uint8_t *buf, uint32_t max)
+{
+    SPI_Slave_t *sl = &SPI_Slave[instance];
+    uint32_t out = sl->out;
+    uint32_t n = 0;
+    
+    while((n < max) && (out != sl->in))
+    {
+        buf[n++] = sl->buf[out & sl->mask];
+        out++;
+    }
+    sl->out = out;
+    return n;
+}
 
+/**
+ * @brief  queue a buffer to be clocked out by the master
+ * @note   buf must stay untouched until SPI_SlaveIsTxBusy returns false
+ * @param  instance: HW_SPI0
+ * @param  buf: data
+ * @param  len: length in bytes
+ * @retval CH_OK or CH_ERR if the previous buffer is still queued
+ */
+uint32_t SPI_SlaveWriteAsync(uint32_t instance, const uint8_t *buf, uint32_t len)
+{
+    SPI_Slave_t *sl = &SPI_Slave[instance];
+    
+    if(sl->tx_len)
+    {
+        return CH_ERR;
+    }
+    sl->tx_buf = buf;
+    sl->tx_len = len;
+    return CH_OK;
+}
+
+bool SPI_SlaveIsTxBusy(uint32_t instance)
+{
+    return (SPI_Slave[instance].tx_len != 0);
+}
+
+void SPI_SlaveGetStat(uint32_t instance, SPI_SlaveStat_t *stat)
+{
+    *stat = SPI_Slave[instance].stat;
+}
+
+void SPI_IRQHandler(uint32_t instance)
+{
+    LPC_SPI_TypeDef *SPIx = SPIBases[instance];
+    SPI_Slave_t *sl = &SPI_Slave[instance];
+    uint32_t stat = SPIx->STAT;
+    uint32_t in;
+    uint8_t ch;
+    
+    if(stat & (SPI_STAT_RXOV | SPI_STAT_TXUR))
+    {
+        if(stat & SPI_STAT_RXOV) sl->stat.rx_overrun++;
+        if(stat & SPI_STAT_TXUR) sl->stat.tx_underrun++;
+        SPIx->STAT = SPI_STAT_RXOV | SPI_STAT_TXUR;
+    }
+    
+    if(stat & SPI_STAT_RXRDY)
+    {
+        ch = (uint8_t)SPIx->RXDAT;
+        in = sl->in;
+        if((in - sl->out) > sl->mask)
+        {
+            sl->stat.ring_overrun++;
+        }
+        else
+        {
+            sl->buf[in & sl->mask] = ch;
+            sl->in = in + 1;
+        }
+        
+        /* the byte just received shifted the previous TXDAT out, load the next one */
+        if(sl->tx_len)
+        {
+            SPIx->TXDAT = *sl->tx_buf++;
+            sl->tx_len--;
+        }
+        else
+        {
+            SPIx->TXDAT = SPI_SLAVE_FILL;
+        }
+    }
+}
+
+void SPI0_IRQHandler(void)
+{
+    SPI_IRQHandler(HW_SPI0);
+}
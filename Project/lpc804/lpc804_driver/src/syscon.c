@@ -49,3 +49,45 @@ uint32_t SetupSystemPLL(uint8_t input_src, uint32_t in_clk, uint32_t out_clk)
     return CH_ERR;
 }
 #endif
+
+#if defined(LPC802)
+/* ROM routine that sets the FRO oscillator in kHz, fro_clk is half of it */
+#define FRO_SET_FREQ_ROM_ADDR   (0x0F0026F5UL)
+
+typedef void (*fro_set_freq_t)(uint32_t khz);
+
+ /**
+ * @brief  run the FRO oscillator at 30MHz, fro_clk and a main clock taken from it go to 15MHz
+ * @note   SystemCoreClock follows, the UART baud rate and the flash CCLK must be set up again by the caller
+ * @param  saved: filled with the clock state to hand to ClockProfileExit
+ * @retval CH_OK, CH_ERR when fro_clk bypasses the divider
+ */
+uint32_t ClockProfileEnter(ClockProfile_t *saved)
+{
+    static const uint32_t fro_khz[] = {18000, 24000, 30000, 30000};
+    
+    saved->fro_khz = fro_khz[LPC_SYSCON->FROOSCCTRL & 0x03];
+    saved->core_clock = SystemCoreClock;
+    
+    /* FRO_DIRECT: 30MHz would reach the core */
+    if(LPC_SYSCON->FROOSCCTRL & (1<<17))
+    {
+        return CH_ERR;
+    }
+    
+    ((fro_set_freq_t)FRO_SET_FREQ_ROM_ADDR)(30000);
+    SystemCoreClockUpdate();
+    return CH_OK;
+}
+
+ /**
+ * @brief  set the FRO oscillator back to the frequency ClockProfileEnter found
+ * @param  saved: clock state from ClockProfileEnter
+ * @retval None
+ */
+void ClockProfileExit(const ClockProfile_t *saved)
+{
+    ((fro_set_freq_t)FRO_SET_FREQ_ROM_ADDR)(saved->fro_khz);
+    SystemCoreClock = saved->core_clock;
+}
+#endif
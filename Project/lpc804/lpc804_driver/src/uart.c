@@ -13,6 +13,26 @@ static LPC_USART_TypeDef* const UARTBases[] = {LPC_USART0, LPC_USART1, LPC_USART
 static LPC_USART_TypeDef* const UARTBases[] = {LPC_USART0, LPC_USART1};
 #endif
 
+#define UART_STAT_RXRDY     (1<<0)
+#define UART_STAT_TXRDY     (1<<2)
+#define UART_STAT_TXIDLE    (1<<3)
+#define UART_STAT_OVERRUN   (1<<8)
+
+/* RX: single producer (IRQ), single consumer (UART_Read) ring
+   TX: the caller's buffer is sent from the TXRDY interrupt until len reaches 0 */
+typedef struct
+{
+    volatile uint8_t *buf;
+    uint32_t mask;
+    volatile uint32_t in;
+    volatile uint32_t out;
+    UART_RxStat_t stat;
+    const uint8_t * volatile tx_buf;
+    volatile uint32_t tx_len;
+}UART_Ring_t;
+
+static UART_Ring_t UART_Ring[ARRAY_SIZE(UARTBases)];
+
 
 int Putc(uint8_t data)
 {
@@ -29,6 +49,12 @@ int Getc(void)
 
 uint32_t UART_GetChar(uint32_t instance, uint8_t *ch)
 {
+    /* receive ring owns the receiver */
+    if(UART_Ring[instance].buf)
+    {
+        return (UART_Read(instance, ch, 1) == 1)?(CH_OK):(CH_ERR);
+    }
+    
     if(UARTBases[instance]->STAT & (1<<0))
     {
         *ch = (UARTBases[instance]->RXDAT & 0xFF);
@@ -47,7 +73,9 @@ void UART_PutChar(uint32_t instance, uint8_t ch)
 
 uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val)
 {
-    (val)?(UARTBases[instance]->INTENSET = (1<<0)):(UARTBases[instance] ->INTENCLR = (1<<0));
+    uint32_t mask = (mode == kUART_IntTx)?(UART_STAT_TXRDY):(UART_STAT_RXRDY);
+    
+    (val)?(UARTBases[instance]->INTENSET = mask):(UARTBases[instance]->INTENCLR = mask);
     
     if(val)
     {
@@ -69,6 +97,169 @@ uint32_t UART_SetIntMode(uint32_t instance, UART_Int_t mode, bool val)
     return CH_OK;
 }
 
+/**
+ * @brief  receive into a ring buffer from the RX interrupt
+ * @note   UART_GetChar and UART_Read then read from the ring
+ * @param  instance: HW_UART0 or HW_UART1
+ * @param  buf: ring storage, must stay valid
+ * @param  size: power of 2
+ * @retval CH_OK or CH_ERR
+ */
+uint32_t UART_EnableRxRing(uint32_t instance, uint8_t *buf, uint32_t size)
+{
+    UART_Ring_t *r = &UART_Ring[instance];
+    
+    if((size == 0) || (size & (size - 1)))
+    {
+        return CH_ERR;
+    }
+    
+    r->mask = size - 1;
+    r->in = 0;
+    r->out = 0;
+    r->buf = buf;
+    
+    UARTBases[instance]->INTENSET = UART_STAT_OVERRUN;
+    UART_SetIntMode(instance, kUART_IntRx, true);
+    return CH_OK;
+}
+
+/**
+ * @brief  read up to max bytes from the receive ring
+ * @param  instance: HW_UART0 or HW_UART1
+ * @param  buf: destination
+ * @param  max: size of buf
+ * @retval number of bytes read, 0 if none
+ */
+uint32_t UART_Read(uint32_t instance, uint8_t *buf, uint32_t max)
+{
+    UART_Ring_t *r = &UART_Ring[instance];
+    uint32_t out = r->out;
+    uint32_t n = 0;
+    
+    if(!r->buf)
+    {
+        return 0;
+    }
+    
+    while((n < max) && (out != r->in))
+    {
+        buf[n++] = r->buf[out & r->mask];
+        out++;
+    }
+    r->out = out;
+    return n;
+}
+
+/**
+ * @brief  get receive loss counters
+ * @param  instance: HW_UART0 or HW_UART1
+ * @param  stat: filled by this function
+ * @retval None
+ */
+void UART_GetRxStat(uint32_t instance, UART_RxStat_t *stat)
+{
+    *stat = UART_Ring[instance].stat;
+}
+
+/**
+ * @brief  start sending a buffer from the TXRDY interrupt and return at once
+ * @note   buf must stay untouched until UART_IsTxBusy returns false
+ * @param  instance: HW_UART0 or HW_UART1
+ * @param  buf: data
+ * @param  len: length in bytes
+ * @retval CH_OK or CH_ERR if the previous buffer is still being sent
+ */
+uint32_t UART_WriteAsync(uint32_t instance, const uint8_t *buf, uint32_t len)
+{
+    UART_Ring_t *r = &UART_Ring[instance];
+    
+    if(r->tx_len)
+    {
+        return CH_ERR;
+    }
+    if(len == 0)
+    {
+        return CH_OK;
+    }
+    
+    r->tx_buf = buf;
+    r->tx_len = len;
+    UART_SetIntMode(instance, kUART_IntTx, true);
+    return CH_OK;
+}
+
+bool UART_IsTxBusy(uint32_t instance)
+{
+    return (UART_Ring[instance].tx_len != 0);
+}
+
+/**
+ * @brief  wait until the last byte has left the shifter
+ * @note   a buffer from UART_WriteAsync is sent first, then TXIDLE: the transmit buffer is empty
+ *         and the line is idle
+ * @param  instance: HW_UART0 or HW_UART1
+ * @retval None
+ */
+void UART_WaitTxComplete(uint32_t instance)
+{
+    while(UART_IsTxBusy(instance));
+    while(!(UARTBases[instance]->STAT & UART_STAT_TXIDLE));
+}
+
+void UART_IRQHandler(uint32_t instance)
+{
+    LPC_USART_TypeDef *UARTx = UARTBases[instance];
+    UART_Ring_t *r = &UART_Ring[instance];
+    uint32_t stat = UARTx->STAT;
+    uint32_t in;
+    uint8_t ch;
+    
+    if(stat & UART_STAT_OVERRUN)
+    {
+        UARTx->STAT = UART_STAT_OVERRUN;
+        r->stat.hw_overrun++;
+    }
+    
+    if((stat & UART_STAT_RXRDY) && r->buf)
+    {
+        in = r->in;
+        ch = (uint8_t)UARTx->RXDAT;
+        if((in - r->out) > r->mask)
+        {
+            r->stat.ring_overrun++;
+        }
+        else
+        {
+            r->buf[in & r->mask] = ch;
+            r->in = in + 1;
+        }
+    }
+    
+    if((stat & UART_STAT_TXRDY) && (UARTx->INTSTAT & UART_STAT_TXRDY))
+    {
+        if(r->tx_len)
+        {
+            UARTx->TXDAT = *r->tx_buf++;
+            r->tx_len--;
+        }
+        if(r->tx_len == 0)
+        {
+            UARTx->INTENCLR = UART_STAT_TXRDY;
+        }
+    }
+}
+
+void UART0_IRQHandler(void)
+{
+    UART_IRQHandler(HW_UART0);
+}
+
+void UART1_IRQHandler(void)
+{
+    UART_IRQHandler(HW_UART1);
+}
+
 #if defined(LPC82X)
 
 void UART_SetBaudRate(uint32_t instance, uint32_t baud)
@@ -107,6 +298,22 @@ uint32_t UART_Init(uint32_t instance, uint32_t baudrate)
 
 #else
 
+/* the FRG0 input follows the core clock, called again after it changes */
+void UART_SetBaudRate(uint32_t instance, uint32_t baud)
+{
+    int m, brg;
+    
+    UARTBases[instance]->CFG &= ~(1<<0);
+    
+    brg = GetClock(kCoreClock) / (16 * baud) - 1;
+    m =  256 * (GetClock(kCoreClock) / (16 * baud * (brg + 1))) - 256;
+    
+    LPC_SYSCON->FRG0MULT = m; 
+    UARTBases[instance]->BRG = brg;
+    
+    UARTBases[instance]->CFG |= (1<<0);
+}
+
 uint32_t UART_Init(uint32_t MAP, uint32_t baudrate)
 {
     int m, brg;
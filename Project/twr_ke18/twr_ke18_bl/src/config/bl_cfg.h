@@ -12,6 +12,32 @@
 /* Base address of user application */
 #define APPLICATION_BASE            (0x8000UL)
 #define BL_TIMEOUT_MS               (300)
+/* physical flash size, the application region runs from APPLICATION_BASE up to its end */
 #define TARGET_FLASH_SIZE           (512*1024)
 
+/* 1: jump to a valid application at once, the listen window only opens on a mailbox request */
+#ifndef BL_FAST_BOOT
+#define BL_FAST_BOOT                (0)
+#endif
+
+/* 1: start only an image whose bl_image header (length, CRC32) matches, pc_tool/image_patch fills it in */
+#ifndef BL_IMAGE_CHECK
+#define BL_IMAGE_CHECK              (0)
+#endif
+
+/* the check result is cached in the last sector of the flash, the application region ends below it */
+#if (BL_IMAGE_CHECK == 1)
+#define BL_IMAGE_CACHE_SIZE         (4096)
+#else
+#define BL_IMAGE_CACHE_SIZE         (0)
+#endif
+#define BL_IMAGE_CACHE_ADDR         (TARGET_FLASH_SIZE - BL_IMAGE_CACHE_SIZE)
+
+/* 1: run at SPLL 96MHz from the first host frame on, the reset clocks are restored before the jump */
+#ifndef BL_CLOCK_PROFILE
+#define BL_CLOCK_PROFILE            (0)
+#endif
+
+/* bl_mailbox_t shared with the application, the bootloader IRAM ends here */
+#define BL_MAILBOX_ADDR             (0x1FFFFFF0UL)
 #endif
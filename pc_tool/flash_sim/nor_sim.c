@@ -0,0 +1,201 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nor_sim.h"
+
+/* typical values, same as FLASH_GetGeometry of each driver */
+static const nor_sim_model_t models[] =
+{
+    /* name     size        erase   pgm     pgm max block       erase   pgm     blk erase   cmd     reprogram */
+    {"k64",     1024*1024,  4096,   8,      8,      512*1024,   15000,  90,     250000,     2,      0},     /* K64 FTFE */
+    {"kl",      128*1024,   1024,   4,      4,      128*1024,   15000,  65,     120000,     2,      0},     /* KL FTFA */
+    {"ke",      64*1024,    512,    8,      8,      64*1024,    20000,  150,    100000,     2,      0},     /* KE0x FTMRH */
+    {"ke1x",    256*1024,   2048,   4,      4,      0,          15000,  65,     0,          2,      0},     /* KE15Z/KE17Z FTFL */
+    {"ke18",    512*1024,   4096,   8,      8,      0,          15000,  90,     0,          2,      0},     /* KE18F FTFE */
+    {"lpc",     32*1024,    64,     64,     1024,   0,          5000,   1000,   0,          30,     1},     /* LPC800 IAP */
+};
+
+ /**
+ * @brief  find a family model by name
+ * @param  name: k64, kl, ke, ke1x, ke18 or lpc
+ * @retval model or NULL
+ */
+const nor_sim_model_t *nor_sim_find_model(const char *name)
+{
+    uint32_t i;
+
+    for(i=0; i<sizeof(models)/sizeof(models[0]); i++)
+    {
+        if(strcmp(models[i].name, name) == 0)
+        {
+            return &models[i];
+        }
+    }
+    return NULL;
+}
+
+void nor_sim_list_models(void)
+{
+    uint32_t i;
+    const nor_sim_model_t *m;
+
+    for(i=0; i<sizeof(models)/sizeof(models[0]); i++)
+    {
+        m = &models[i];
+        printf("  %-4s %4dKB erase:%4dB/%5dus program:%2dB/%4dus block:%dKB\r\n", m->name, m->flash_size/1024,
+                m->erase_unit, m->erase_us, m->program_unit, m->program_us, m->block_size/1024);
+    }
+}
+
+ /**
+ * @brief  create the flash array
+ * @param  sim: simulator instance
+ * @param  model: family model
+ * @param  fill: initial content, 0xFF for a blank part
+ * @retval NOR_SIM_OK or -1 when out of memory
+ */
+int nor_sim_init(nor_sim_t *sim, const nor_sim_model_t *model, uint8_t fill)
+{
+    memset(sim, 0, sizeof(nor_sim_t));
+    sim->model = model;
+    sim->mem = malloc(model->flash_size);
+    if(!sim->mem)
+    {
+        return -1;
+    }
+    memset(sim->mem, fill, model->flash_size);
+    return NOR_SIM_OK;
+}
+
+void nor_sim_deinit(nor_sim_t *sim)
+{
+    free(sim->mem);
+    sim->mem = NULL;
+}
+
+static int in_range(nor_sim_t *sim, uint32_t addr, uint32_t len)
+{
+    if((len > sim->model->flash_size) || (addr > (sim->model->flash_size - len)))
+    {
+        sim->err_range++;
+        return 0;
+    }
+    return 1;
+}
+
+ /**
+ * @brief  erase the erase unit containing addr, like FLASH_EraseSector / FLASH_ErasePage
+ * @param  sim: simulator instance
+ * @param  addr: any address in the unit
+ * @retval NOR_SIM_OK or error code
+ */
+int nor_sim_erase(nor_sim_t *sim, uint32_t addr)
+{
+    const nor_sim_model_t *m = sim->model;
+
+    if(!in_range(sim, addr, 1)) return NOR_SIM_ERR_RANGE;
+
+    addr &= ~(m->erase_unit - 1);
+    memset(sim->mem + addr, 0xFF, m->erase_unit);
+    sim->erase_cnt++;
+    sim->busy_us += m->cmd_us + m->erase_us;
+    return NOR_SIM_OK;
+}
+
+ /**
+ * @brief  erase the block containing addr, like FLASH_EraseBlock
+ * @param  sim: simulator instance
+ * @param  addr: any address in the block
+ * @retval NOR_SIM_OK or error code
+ */
+int nor_sim_erase_block(nor_sim_t *sim, uint32_t addr)
+{
+    const nor_sim_model_t *m = sim->model;
+
+    if(m->block_size == 0)
+    {
+        sim->err_align++;
+        return NOR_SIM_ERR_ALIGN;
+    }
+    if(!in_range(sim, addr, 1)) return NOR_SIM_ERR_RANGE;
+
+    addr &= ~(m->block_size - 1);
+    memset(sim->mem + addr, 0xFF, m->block_size);
+    sim->block_erase_cnt++;
+    sim->busy_us += m->cmd_us + m->block_erase_us;
+    return NOR_SIM_OK;
+}
+
+ /**
+ * @brief  program like FLASH_WriteSector: whole program units at aligned addresses
+ * @note   a misaligned address or length and programming a unit that is not blank
+ *         (on families without reprogram_ok) are counted and refused
+ * @param  sim: simulator instance
+ * @param  addr: destination address
+ * @param  buf: data
+ * @param  len: length in bytes
+ * @retval NOR_SIM_OK or error code
+ */
+int nor_sim_program(nor_sim_t *sim, uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    const nor_sim_model_t *m = sim->model;
+    uint32_t i, n;
+
+    if(!in_range(sim, addr, len)) return NOR_SIM_ERR_RANGE;
+    if((addr & (m->program_unit - 1)) || (len & (m->program_unit - 1)))
+    {
+        sim->err_align++;
+        return NOR_SIM_ERR_ALIGN;
+    }
+
+    while(len)
+    {
+        /* one command: IAP copies up to program_max within one sector, FTF one unit */
+        n = m->program_max;
+        while((n > len) || (addr & (n - 1)))
+        {
+            n >>= 1;
+        }
+
+        if(!m->reprogram_ok)
+        {
+            for(i=0; i<n; i++)
+            {
+                if(sim->mem[addr + i] != 0xFF)
+                {
+                    sim->err_not_erased++;
+                    return NOR_SIM_ERR_NOT_ERASED;
+                }
+            }
+        }
+
+        /* NOR program can only clear bits */
+        for(i=0; i<n; i++)
+        {
+            sim->mem[addr + i] &= buf[i];
+        }
+        sim->program_cmd_cnt++;
+        sim->busy_us += m->cmd_us + m->program_us * (n / m->program_unit);
+
+        addr += n;
+        buf += n;
+        len -= n;
+    }
+    return NOR_SIM_OK;
+}
+
+int nor_sim_read(nor_sim_t *sim, uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    if(!in_range(sim, addr, len)) return NOR_SIM_ERR_RANGE;
+
+    memcpy(buf, sim->mem + addr, len);
+    return NOR_SIM_OK;
+}
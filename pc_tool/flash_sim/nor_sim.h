@@ -0,0 +1,61 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef __NOR_SIM_H__
+#define __NOR_SIM_H__
+
+#include <stdint.h>
+
+/* return code */
+#define NOR_SIM_OK              (0)
+#define NOR_SIM_ERR_RANGE       (1)
+#define NOR_SIM_ERR_ALIGN       (2)
+#define NOR_SIM_ERR_NOT_ERASED  (3)
+
+/* one flash controller family, geometry and typical times follow drivers_xxx/src/flash.c */
+typedef struct
+{
+    const char *name;
+    uint32_t flash_size;
+    uint32_t erase_unit;        /* ERSSCR sector or IAP page */
+    uint32_t program_unit;      /* bytes of one program command: PGM4, PGM8, FTMRH 2 longwords, IAP page */
+    uint32_t program_max;       /* largest single program command, > program_unit only for IAP copy */
+    uint32_t block_size;        /* ERSBLK size, 0: no block erase */
+    uint32_t erase_us;
+    uint32_t program_us;        /* per program unit */
+    uint32_t block_erase_us;
+    uint32_t cmd_us;            /* command launch or IAP call overhead */
+    uint32_t reprogram_ok;      /* 1: programming over programmed bits is allowed and ANDs them */
+}nor_sim_model_t;
+
+typedef struct
+{
+    const nor_sim_model_t *model;
+    uint8_t *mem;
+
+    /* statistics */
+    uint64_t busy_us;
+    uint32_t erase_cnt;
+    uint32_t block_erase_cnt;
+    uint32_t program_cmd_cnt;
+    uint32_t err_range;
+    uint32_t err_align;
+    uint32_t err_not_erased;
+}nor_sim_t;
+
+
+const nor_sim_model_t *nor_sim_find_model(const char *name);
+void nor_sim_list_models(void);
+int nor_sim_init(nor_sim_t *sim, const nor_sim_model_t *model, uint8_t fill);
+void nor_sim_deinit(nor_sim_t *sim);
+int nor_sim_erase(nor_sim_t *sim, uint32_t addr);
+int nor_sim_erase_block(nor_sim_t *sim, uint32_t addr);
+int nor_sim_program(nor_sim_t *sim, uint32_t addr, const uint8_t *buf, uint32_t len);
+int nor_sim_read(nor_sim_t *sim, uint32_t addr, uint8_t *buf, uint32_t len);
+
+#endif
+
@@ -0,0 +1,915 @@
+/*
+ * Copyright 2018-2020 NXP
+ * All rights reserved.
+ *
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "nor_sim.h"
+#include "mflash.h"
+#include "mcuboot.h"
+#include "bl_burst.h"
+
+static nor_sim_t nor;
+static mflash_t mflash;
+static mcuboot_t mcuboot;
+static bl_burst_t burst;
+
+/* host side: decodes what the bootloader sends */
+typedef struct
+{
+    frame_packet_t pkt;
+    pkt_dec_t dec;
+    uint32_t resp_cnt;
+    uint32_t resp_status;
+    uint32_t ack_cnt;
+    uint32_t prop[7];       /* parameters of the last property response */
+    uint32_t prop_cnt;
+    uint32_t ack_due;       /* a response came in, blhost acks it in front of its next frame */
+}host_t;
+
+static host_t host;
+
+/* time accounting, link bytes are 10 bits on the wire */
+static uint32_t baud = 115200;
+static uint64_t link_bytes;
+static double total_us;
+
+/* 0: one whole frame per mcuboot_recv, else the board reads the link in chunks of this size */
+static uint32_t rx_chunk;
+
+/* raw strategy: the board code before mflash, passes packets straight to the driver */
+static int raw_erase(uint32_t start_addr, uint32_t byte_cnt)
+{
+    uint32_t addr;
+
+    for(addr = start_addr; addr < (start_addr + byte_cnt); addr += nor.model->erase_unit)
+    {
+        nor_sim_erase(&nor, addr);
+    }
+    return 0;
+}
+
+static int raw_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
+{
+    return nor_sim_program(&nor, start_addr, buf, byte_cnt);
+}
+
+/* mflash strategy */
+static int flash_erase(uint32_t addr)
+{
+    return nor_sim_erase(&nor, addr);
+}
+
+static int flash_erase_block(uint32_t addr)
+{
+    return nor_sim_erase_block(&nor, addr);
+}
+
+static int flash_program(uint32_t addr, const uint8_t *buf, uint32_t len)
+{
+    return nor_sim_program(&nor, addr, buf, len);
+}
+
+static int flash_read(uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    return nor_sim_read(&nor, addr, buf, len);
+}
+
+static int memory_erase(uint32_t start_addr, uint32_t byte_cnt)
+{
+    return mflash_erase(&mflash, start_addr, byte_cnt);
+}
+
+static int memory_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
+{
+    return mflash_write(&mflash, start_addr, buf, byte_cnt);
+}
+
+static int memory_flush(void)
+{
+    return mflash_flush(&mflash);
+}
+
+static int memory_read(uint32_t addr, uint8_t *buf, uint32_t len)
+{
+    return nor_sim_read(&nor, addr, buf, len);
+}
+
+/* burst strategy: a WriteMemory that fits the RAM buffer only reaches the flash once it is complete */
+static int burst_begin(uint32_t addr, uint32_t len)
+{
+    bl_burst_begin(&burst, addr, len);
+    return bl_burst_is_active(&burst);
+}
+
+static int burst_write(uint32_t start_addr, uint8_t *buf, uint32_t byte_cnt)
+{
+    if(bl_burst_is_active(&burst))
+    {
+        return bl_burst_write(&burst, start_addr, buf, byte_cnt);
+    }
+    return mflash_write(&mflash, start_addr, buf, byte_cnt);
+}
+
+static int burst_flush(void)
+{
+    if(bl_burst_is_active(&burst))
+    {
+        return bl_burst_commit(&burst);
+    }
+    return mflash_flush(&mflash);
+}
+
+static void host_dec_cb(frame_packet_t *pkt, void *user)
+{
+    host_t *h = (host_t*)user;
+    uint32_t param[2];
+
+    switch(pkt->hr.packet_type)
+    {
+        case kFramingPacketType_Ack:
+            h->ack_cnt++;
+            break;
+        case kFramingPacketType_Command:
+            h->ack_due = 1;
+            if(pkt->payload[0] == kCommandTag_GenericResponse)
+            {
+                memcpy(param, &pkt->payload[4], sizeof(param));
+                h->resp_status = param[0];
+                h->resp_cnt++;
+            }
+            if(pkt->payload[0] == kCommandTag_GetPropertyResponse)
+            {
+                h->prop_cnt = (pkt->payload[3] > 7)?(7):(pkt->payload[3]);
+                memcpy(h->prop, &pkt->payload[4], h->prop_cnt * sizeof(uint32_t));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int mcuboot_send(uint8_t *buf, uint32_t len)
+{
+    link_bytes += len;
+    total_us += len * 10 * 1000000.0 / baud;
+    while(len--)
+    {
+        kptl_decode(&host.dec, *buf++);
+    }
+    return 0;
+}
+
+static void mcuboot_reset(void) {}
+static void mcuboot_jump(uint32_t addr, uint32_t arg, uint32_t sp) {}
+static void mcuboot_complete(void) {}
+
+/* the board main loop: each read returns up to chunk bytes, which may end or start anywhere in a
+   frame. What mcuboot_recv does not take is passed again after mcuboot_proc */
+static void board_feed(mcuboot_t *ctx, uint8_t *buf, uint32_t len, uint32_t chunk)
+{
+    uint32_t n, pos;
+
+    while(len)
+    {
+        n = (chunk && (len > chunk))?(chunk):(len);
+        pos = 0;
+        do
+        {
+            pos += mcuboot_recv(ctx, buf + pos, n - pos);
+            mcuboot_proc(ctx);
+        }while(pos < n);
+        buf += n;
+        len -= n;
+    }
+}
+
+/* one host frame into the bootloader, overlap: flash work hidden behind the next frame.
+   With rx_chunk the ACK blhost owes for the last response goes right in front of the frame */
+static void host_send(uint8_t *buf, uint32_t len, int overlap)
+{
+    uint8_t wire[sizeof(packet_ack_t) + sizeof(frame_packet_t)];
+    double link_us, flash_us;
+    uint64_t busy;
+    uint32_t n = 0;
+
+    if(rx_chunk && host.ack_due)
+    {
+        kptl_create_ack((packet_ack_t*)wire);
+        n = sizeof(packet_ack_t);
+        host.ack_due = 0;
+    }
+    memcpy(wire + n, buf, len);
+    len += n;
+
+    link_bytes += len;
+    link_us = len * 10 * 1000000.0 / baud;
+
+    busy = nor.busy_us;
+    board_feed(&mcuboot, wire, len, rx_chunk);
+    flash_us = (double)(nor.busy_us - busy);
+
+    if(overlap)
+    {
+        total_us += (link_us > flash_us)?(link_us):(flash_us);
+    }
+    else
+    {
+        total_us += link_us + flash_us;
+    }
+}
+
+static uint32_t host_cmd(uint8_t tag, uint8_t param_cnt, uint32_t p0, uint32_t p1)
+{
+    frame_packet_t fp;
+    cmd_packet_t cp;
+    uint32_t param[2];
+
+    param[0] = p0;
+    param[1] = p1;
+    cp.tag = tag;
+    cp.flags = 0;
+    cp.reserved = 0;
+    cp.param_cnt = param_cnt;
+    kptl_create_cmd_packet(&fp, &cp, param);
+
+    host.resp_cnt = 0;
+    host_send((uint8_t*)&fp, kptl_frame_packet_get_size(&fp), 0);
+    return (host.resp_cnt)?(host.resp_status):(0xFFFFFFFF);
+}
+
+static void host_ping(void)
+{
+    packet_ping_t ping;
+
+    kptl_create_ping(&ping);
+    host_send((uint8_t*)&ping, sizeof(ping), 0);
+}
+
+/* image with random code and a 0xFF padded gap like a linker fill */
+static void make_image(uint8_t *img, uint32_t len)
+{
+    uint32_t i;
+
+    srand(1);
+    for(i=0; i<len; i++)
+    {
+        img[i] = (uint8_t)rand();
+    }
+    if(len > 4096)
+    {
+        memset(img + len/2, 0xFF, 2048);
+    }
+}
+
+/* dual mode: two mcuboot instances with their own host and half of the application region,
+   the two links are fed in small interleaved chunks as two UARTs would deliver them */
+#define DUAL_CHUNK          (7)
+
+typedef struct
+{
+    mcuboot_t boot;
+    mflash_t mflash;
+    host_t host;
+    uint32_t base;
+    uint32_t len;
+    uint8_t *img;
+    uint32_t step;          /* 0: ping, 1: erase, 2: write memory, 3..: data */
+    uint32_t img_pos;
+    frame_packet_t fp;      /* frame on the wire */
+    uint32_t fp_len;
+    uint32_t fp_pos;
+}port_t;
+
+static port_t port[2];
+
+static int port_send(port_t *pt, uint8_t *buf, uint32_t len)
+{
+    while(len--)
+    {
+        kptl_decode(&pt->host.dec, *buf++);
+    }
+    return 0;
+}
+
+#define PORT_OPS(n) \
+static int port##n##_send(uint8_t *buf, uint32_t len) { return port_send(&port[n], buf, len); } \
+static int port##n##_erase(uint32_t addr, uint32_t len) { return mflash_erase(&port[n].mflash, addr, len); } \
+static int port##n##_write(uint32_t addr, uint8_t *buf, uint32_t len) { return mflash_write(&port[n].mflash, addr, buf, len); } \
+static int port##n##_flush(void) { return mflash_flush(&port[n].mflash); }
+
+PORT_OPS(0)
+PORT_OPS(1)
+
+/* build the next host frame, returns 0 when the download is complete */
+static int port_next_frame(port_t *pt)
+{
+    cmd_packet_t cp;
+    uint32_t param[2];
+    uint32_t n;
+
+    cp.flags = 0;
+    cp.reserved = 0;
+    cp.param_cnt = 2;
+    param[0] = pt->base;
+    param[1] = pt->len;
+
+    switch(pt->step)
+    {
+        case 0:
+            kptl_create_ping((packet_ping_t*)&pt->fp);
+            pt->fp_len = sizeof(packet_ping_t);
+            break;
+        case 1:
+        case 2:
+            cp.tag = (pt->step == 1)?(kCommandTag_FlashEraseRegion):(kCommandTag_WriteMemory);
+            kptl_create_cmd_packet(&pt->fp, &cp, param);
+            pt->fp_len = kptl_frame_packet_get_size(&pt->fp);
+            break;
+        default:
+            if(pt->img_pos >= pt->len)
+            {
+                return 0;
+            }
+            n = ((pt->len - pt->img_pos) > MAX_PACKET_LEN)?(MAX_PACKET_LEN):(pt->len - pt->img_pos);
+            kptl_frame_packet_begin(&pt->fp, kFramingPacketType_Data);
+            kptl_frame_packet_add(&pt->fp, pt->img + pt->img_pos, n);
+            kptl_frame_packet_final(&pt->fp);
+            pt->fp_len = kptl_frame_packet_get_size(&pt->fp);
+            pt->img_pos += n;
+            break;
+    }
+    pt->step++;
+    pt->fp_pos = 0;
+    return 1;
+}
+
+static int run_dual(const nor_sim_model_t *model, uint32_t app_base, uint32_t img_len)
+{
+    uint8_t chunk[DUAL_CHUNK];
+    uint32_t half, i, n, k, pos, active;
+    int ret = 0, ok;
+    port_t *pt;
+
+    half = ((model->flash_size - app_base) / 2) & ~(model->erase_unit - 1);
+    if(img_len > half)
+    {
+        img_len = half;
+    }
+
+    for(i=0; i<2; i++)
+    {
+        pt = &port[i];
+        memset(pt, 0, sizeof(port_t));
+        pt->base = app_base + i * half;
+        pt->len = img_len;
+        pt->img = malloc(img_len);
+        make_image(pt->img, img_len);
+        if(i)
+        {
+            for(n=0; n<img_len; n++) pt->img[n] = ~pt->img[n];
+        }
+
+        pt->mflash.cfg_start = pt->base;
+        pt->mflash.cfg_size = half;
+        pt->mflash.cfg_erase_unit = model->erase_unit;
+        pt->mflash.cfg_program_unit = model->program_unit;
+        pt->mflash.cfg_block_size = model->block_size;
+        pt->mflash.op_erase = flash_erase;
+        pt->mflash.op_program = flash_program;
+        pt->mflash.op_read = flash_read;
+        pt->mflash.op_erase_block = (model->block_size)?(flash_erase_block):(NULL);
+        mflash_init(&pt->mflash);
+
+        pt->boot.op_send = (i)?(port1_send):(port0_send);
+        pt->boot.op_mem_erase = (i)?(port1_erase):(port0_erase);
+        pt->boot.op_mem_write = (i)?(port1_write):(port0_write);
+        pt->boot.op_mem_flush = (i)?(port1_flush):(port0_flush);
+        pt->boot.op_mem_read = memory_read;
+        pt->boot.op_reset = mcuboot_reset;
+        pt->boot.op_jump = mcuboot_jump;
+        pt->boot.op_complete = mcuboot_complete;
+        pt->boot.cfg_flash_start = pt->base;
+        pt->boot.cfg_flash_size = half;
+        pt->boot.cfg_flash_sector_size = model->erase_unit;
+        mcuboot_init(&pt->boot);
+
+        pt->host.dec.fp = &pt->host.pkt;
+        pt->host.dec.cb = host_dec_cb;
+        pt->host.dec.user = &pt->host;
+        kptl_decode_init(&pt->host.dec);
+
+        port_next_frame(pt);
+    }
+
+    /* each link streams its frames back to back, a chunk may hold the end of one frame and the
+       start of the next */
+    do
+    {
+        active = 0;
+        for(i=0; i<2; i++)
+        {
+            pt = &port[i];
+            for(n = 0; n < DUAL_CHUNK; n += k)
+            {
+                if(pt->fp_pos == pt->fp_len && !port_next_frame(pt))
+                {
+                    break;
+                }
+                k = ((pt->fp_len - pt->fp_pos) > (DUAL_CHUNK - n))?(DUAL_CHUNK - n):(pt->fp_len - pt->fp_pos);
+                memcpy(chunk + n, (uint8_t*)&pt->fp + pt->fp_pos, k);
+                pt->fp_pos += k;
+            }
+            if(n == 0)
+            {
+                continue;
+            }
+            active++;
+
+            for(pos = 0; pos < n; )
+            {
+                pos += mcuboot_recv(&pt->boot, chunk + pos, n - pos);
+                mcuboot_proc(&port[0].boot);
+                mcuboot_proc(&port[1].boot);
+            }
+        }
+    }while(active);
+
+    printf("family %s, two instances, image %d bytes at 0x%X and 0x%X, chunk %d bytes\r\n", model->name,
+            img_len, port[0].base, port[1].base, DUAL_CHUNK);
+    for(i=0; i<2; i++)
+    {
+        pt = &port[i];
+        ok = (pt->host.resp_cnt == 3) && (pt->host.resp_status == 0) && (memcmp(nor.mem + pt->base, pt->img, img_len) == 0);
+        ret |= !ok;
+        printf("port %d:     responses %d, status 0x%X, acks %d, verify %s\r\n", i, pt->host.resp_cnt,
+                pt->host.resp_status, pt->host.ack_cnt, (ok)?("OK"):("FAILED"));
+        free(pt->img);
+    }
+    printf("violations: range %d, align %d, not erased %d\r\n", nor.err_range, nor.err_align, nor.err_not_erased);
+    if(nor.err_range || nor.err_align || nor.err_not_erased)
+    {
+        ret = 1;
+    }
+    return ret;
+}
+
+#if (MCUBOOT_MULTIDROP == 1)
+/* bus mode: nodes with their own flash on one multi-drop bus, the host broadcasts the image once,
+   then polls every node and retransmits the frames it missed */
+#define BUS_CHUNK           (16)
+
+typedef struct
+{
+    nor_sim_t nor;
+    mflash_t mflash;
+    mcuboot_t boot;
+    uint8_t wire[sizeof(frame_packet_t) + BUS_CHUNK];   /* heard, not yet read by the node */
+    uint32_t wire_len;
+    uint32_t lost;
+    uint32_t resent;
+}node_t;
+
+static node_t *node;
+static node_t *cur;         /* node being fed, the op callbacks carry no context */
+
+static int node_flash_erase(uint32_t addr) { return nor_sim_erase(&cur->nor, addr); }
+static int node_flash_erase_block(uint32_t addr) { return nor_sim_erase_block(&cur->nor, addr); }
+static int node_flash_program(uint32_t addr, const uint8_t *buf, uint32_t len) { return nor_sim_program(&cur->nor, addr, buf, len); }
+static int node_flash_read(uint32_t addr, uint8_t *buf, uint32_t len) { return nor_sim_read(&cur->nor, addr, buf, len); }
+static int node_mem_erase(uint32_t addr, uint32_t len) { return mflash_erase(&cur->mflash, addr, len); }
+static int node_mem_write(uint32_t addr, uint8_t *buf, uint32_t len) { return mflash_write(&cur->mflash, addr, buf, len); }
+static int node_mem_flush(void) { return mflash_flush(&cur->mflash); }
+
+/* one frame on the bus, every node hears it; loss: per mille of data frames a node misses.
+   A node reads the bus in BUS_CHUNK pieces, so a read can hold the tail of one data frame and
+   the head of the next. The line goes idle after a command, the node then reads what is left */
+static void bus_frame(uint32_t node_cnt, frame_packet_t *fp, int is_data, uint32_t loss)
+{
+    uint32_t i, len, n;
+    uint64_t busy, flash_us = 0;
+    double link_us;
+
+    len = kptl_frame_packet_get_size(fp);
+    link_bytes += len;
+    link_us = len * 10 * 1000000.0 / baud;
+
+    for(i=0; i<node_cnt; i++)
+    {
+        cur = &node[i];
+        if(is_data && loss && ((uint32_t)(rand() % 1000) < loss))
+        {
+            cur->lost++;
+            continue;
+        }
+        memcpy(cur->wire + cur->wire_len, fp, len);
+        cur->wire_len += len;
+        n = (is_data)?(cur->wire_len - (cur->wire_len % BUS_CHUNK)):(cur->wire_len);
+        busy = cur->nor.busy_us;
+        board_feed(&cur->boot, cur->wire, n, BUS_CHUNK);
+        cur->wire_len -= n;
+        memmove(cur->wire, cur->wire + n, cur->wire_len);
+        if((cur->nor.busy_us - busy) > flash_us)
+        {
+            flash_us = cur->nor.busy_us - busy;
+        }
+    }
+
+    /* nodes program in parallel; data frames are streamed, commands wait for the slowest node */
+    if(is_data)
+    {
+        total_us += (link_us > flash_us)?(link_us):(flash_us);
+    }
+    else
+    {
+        total_us += link_us + flash_us;
+    }
+}
+
+static void bus_cmd(uint32_t node_cnt, uint8_t id, uint8_t tag, uint8_t param_cnt, uint32_t p0, uint32_t p1)
+{
+    frame_packet_t fp, inner;
+    cmd_packet_t cp;
+    uint32_t param[2];
+
+    param[0] = p0;
+    param[1] = p1;
+    cp.tag = tag;
+    cp.flags = 0;
+    cp.reserved = 0;
+    cp.param_cnt = param_cnt;
+    kptl_create_cmd_packet(&inner, &cp, param);
+    kptl_create_addressed_packet(&fp, id, kFramingPacketType_Command, 0, inner.payload, ARRAY2INT16(inner.len));
+    bus_frame(node_cnt, &fp, 0, 0);
+}
+
+static void bus_data(uint32_t node_cnt, uint8_t id, uint8_t *img, uint32_t img_len, uint32_t seq, uint32_t loss)
+{
+    frame_packet_t fp;
+    uint32_t off, n;
+
+    off = seq * MCUBOOT_MD_CHUNK;
+    n = ((img_len - off) > MCUBOOT_MD_CHUNK)?(MCUBOOT_MD_CHUNK):(img_len - off);
+    kptl_create_addressed_packet(&fp, id, kFramingPacketType_Data, seq, img + off, n);
+    bus_frame(node_cnt, &fp, 1, loss);
+}
+
+static int run_bus(const nor_sim_model_t *model, uint32_t app_base, uint32_t img_len, uint32_t node_cnt, uint32_t loss, uint8_t fill)
+{
+    uint8_t *img;
+    uint32_t i, seq, frames, crc = 0, polls = 0, mask, bit;
+    int ret = 0, ok;
+    node_t *nd;
+
+    if(img_len > (MCUBOOT_MD_MAX_FRAMES * MCUBOOT_MD_CHUNK))
+    {
+        img_len = MCUBOOT_MD_MAX_FRAMES * MCUBOOT_MD_CHUNK;
+    }
+    frames = (img_len + MCUBOOT_MD_CHUNK - 1) / MCUBOOT_MD_CHUNK;
+    img = malloc(img_len);
+    make_image(img, img_len);
+    crc32_update(&crc, img, img_len);
+
+    node = calloc(node_cnt, sizeof(node_t));
+    for(i=0; i<node_cnt; i++)
+    {
+        nd = &node[i];
+        if(nor_sim_init(&nd->nor, model, fill) != NOR_SIM_OK)
+        {
+            return 1;
+        }
+        nd->mflash.cfg_start = app_base;
+        nd->mflash.cfg_size = model->flash_size - app_base;
+        nd->mflash.cfg_erase_unit = model->erase_unit;
+        nd->mflash.cfg_program_unit = model->program_unit;
+        nd->mflash.cfg_block_size = model->block_size;
+        nd->mflash.op_erase = node_flash_erase;
+        nd->mflash.op_program = node_flash_program;
+        nd->mflash.op_read = node_flash_read;
+        nd->mflash.op_erase_block = (model->block_size)?(node_flash_erase_block):(NULL);
+        mflash_init(&nd->mflash);
+
+        nd->boot.op_send = mcuboot_send;
+        nd->boot.op_reset = mcuboot_reset;
+        nd->boot.op_jump = mcuboot_jump;
+        nd->boot.op_complete = mcuboot_complete;
+        nd->boot.op_mem_erase = node_mem_erase;
+        nd->boot.op_mem_write = node_mem_write;
+        nd->boot.op_mem_read = node_flash_read;
+        nd->boot.op_mem_flush = node_mem_flush;
+        nd->boot.cfg_flash_start = app_base;
+        nd->boot.cfg_flash_size = model->flash_size - app_base;
+        nd->boot.cfg_flash_sector_size = model->erase_unit;
+        nd->boot.cfg_node_id = i + 1;
+        mcuboot_init(&nd->boot);
+    }
+
+    /* broadcast phase, nodes stay silent */
+    srand(2);
+    bus_cmd(node_cnt, KPTL_NODE_BROADCAST, kCommandTag_FlashEraseRegion, 2, app_base, img_len);
+    bus_cmd(node_cnt, KPTL_NODE_BROADCAST, kCommandTag_WriteMemory, 2, app_base, img_len);
+    for(seq = 0; seq < frames; seq++)
+    {
+        bus_data(node_cnt, KPTL_NODE_BROADCAST, img, img_len, seq, loss);
+    }
+
+    /* poll phase: each node reports its gaps, 32 frames at a time, and gets them resent */
+    for(i=0; i<node_cnt; i++)
+    {
+        nd = &node[i];
+        seq = 0;
+        while(1)
+        {
+            host.prop_cnt = 0;
+            bus_cmd(node_cnt, i + 1, kCommandTag_MultidropStatus, 1, seq, 0);
+            polls++;
+            if(host.prop_cnt != 5 || host.prop[2] >= frames)
+            {
+                break;
+            }
+            seq = host.prop[2];
+            mask = host.prop[3];
+            for(bit = 0; bit < 32; bit++)
+            {
+                if(mask & (1U << bit))
+                {
+                    bus_data(node_cnt, i + 1, img, img_len, seq + bit, 0);
+                    nd->resent++;
+                }
+            }
+        }
+
+        ok = (host.prop_cnt == 5) && (host.prop[1] == frames) && (host.prop[4] == crc) &&
+             (memcmp(nd->nor.mem + app_base, img, img_len) == 0) &&
+             !nd->nor.err_range && !nd->nor.err_align && !nd->nor.err_not_erased;
+        ret |= !ok;
+        if((i < 8) || !ok)
+        {
+            printf("node %3d:   missed %d, resent %d, crc32 0x%08X, verify %s\r\n", i + 1, nd->lost, nd->resent,
+                    host.prop[4], (ok)?("OK"):("FAILED"));
+        }
+    }
+
+    printf("family %s, %d nodes, image %d bytes at 0x%X, %d frames of %d bytes, loss %d/1000, %d baud\r\n",
+            model->name, node_cnt, img_len, app_base, frames, (int)MCUBOOT_MD_CHUNK, loss, baud);
+    printf("bus:        %d status polls, link %.1fms, total %.1fms, %.1fms per node\r\n", polls,
+            link_bytes * 10 * 1000.0 / baud, total_us/1000.0, total_us/1000.0/node_cnt);
+    printf("verify:     %s\r\n", (ret)?("FAILED"):("OK"));
+
+    for(i=0; i<node_cnt; i++)
+    {
+        nor_sim_deinit(&node[i].nor);
+    }
+    free(node);
+    free(img);
+    return ret;
+}
+#endif
+
+static void usage(const char *name)
+{
+    printf("usage: %s [-f family] [-a app_base] [-n image_len] [-o offset] [-b baud] [-c chunk] [-r] [-B ram_kb] [-k] [-e] [-E] [-d] [-m] [-N nodes [-l loss]]\r\n", name);
+    printf("  -o  the download starts this many bytes into the application region, with -E the bytes around it must survive\r\n");
+    printf("  -c  the board reads the link in chunks of this many bytes, the host acks each response\r\n");
+    printf("  -r  raw strategy: data packets go straight to the driver (board code before mflash)\r\n");
+    printf("  -B  burst strategy: a WriteMemory up to this many KB is received into RAM, then programmed (bl_burst)\r\n");
+    printf("  -k  ack data packets before programming (cfg_ack_before_write)\r\n");
+    printf("  -e  FlashEraseAll instead of FlashEraseRegion\r\n");
+    printf("  -E  no erase command, WriteMemory erases on demand (MCUBOOT_ERASE_ON_DEMAND)\r\n");
+    printf("  -d  start with a programmed (0x00) part instead of a blank one\r\n");
+    printf("  -m  two mcuboot instances on two interleaved links, each owning half of the region\r\n");
+    printf("  -N  multi-drop bus with this many nodes: broadcast download, status polling, retransmission\r\n");
+    printf("  -l  with -N: per mille of data frames each node misses\r\n");
+    printf("families:\r\n");
+    nor_sim_list_models();
+}
+
+int main(int argc, char **argv)
+{
+    const nor_sim_model_t *model;
+    uint8_t *img;
+    uint32_t app_base = 0xFFFFFFFF;
+    uint32_t img_len = 0;
+    uint32_t off = 0, addr, end, lo, hi, ua, ue, kept = 1;
+    uint32_t pos, n, status, ret = 0;
+    int raw = 0, ack_first = 0, erase_all = 0, dual = 0, no_erase = 0;
+    uint32_t burst_kb = 0;
+    uint32_t node_cnt = 0, loss = 0;
+    uint8_t fill = 0xFF;
+    frame_packet_t fp;
+    int opt;
+
+    model = nor_sim_find_model("k64");
+    while((opt = getopt(argc, argv, "f:a:n:o:b:c:rB:keEdmN:l:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'f': model = nor_sim_find_model(optarg); break;
+            case 'a': app_base = strtoul(optarg, NULL, 0); break;
+            case 'n': img_len = strtoul(optarg, NULL, 0); break;
+            case 'o': off = strtoul(optarg, NULL, 0); break;
+            case 'b': baud = strtoul(optarg, NULL, 0); break;
+            case 'c': rx_chunk = strtoul(optarg, NULL, 0); break;
+            case 'r': raw = 1; break;
+            case 'B': burst_kb = strtoul(optarg, NULL, 0); break;
+            case 'k': ack_first = 1; break;
+            case 'e': erase_all = 1; break;
+            case 'E': no_erase = 1; break;
+            case 'd': fill = 0x00; break;
+            case 'm': dual = 1; break;
+            case 'N': node_cnt = strtoul(optarg, NULL, 0); break;
+            case 'l': loss = strtoul(optarg, NULL, 0); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if(!model)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* APPLICATION_BASE and a default image of a quarter of the application region */
+    if(app_base == 0xFFFFFFFF)
+    {
+        app_base = (model->flash_size >= 64*1024)?(0x8000):(0x1800);
+    }
+    if(img_len == 0)
+    {
+        img_len = (model->flash_size - app_base) / 4 + 13;
+    }
+    if((app_base >= model->flash_size) || (off > (model->flash_size - app_base)) || (img_len > (model->flash_size - app_base - off)))
+    {
+        printf("image does not fit: base 0x%X offset 0x%X len %d flash %dKB\r\n", app_base, off, img_len, model->flash_size/1024);
+        return 1;
+    }
+
+    host.dec.fp = &host.pkt;
+    host.dec.cb = host_dec_cb;
+    host.dec.user = &host;
+    kptl_decode_init(&host.dec);
+
+    if(node_cnt)
+    {
+#if (MCUBOOT_MULTIDROP == 1)
+        return run_bus(model, app_base, img_len, (node_cnt > 254)?(254):(node_cnt), loss, fill);
+#else
+        (void)loss;
+        printf("-N needs a build with -DMCUBOOT_MULTIDROP=1\r\n");
+        return 1;
+#endif
+    }
+
+    if(nor_sim_init(&nor, model, fill) != NOR_SIM_OK)
+    {
+        return 1;
+    }
+    if(dual)
+    {
+        ret = run_dual(model, app_base, img_len);
+        nor_sim_deinit(&nor);
+        return ret;
+    }
+
+    img = malloc(img_len);
+    make_image(img, img_len);
+
+    /* the first and last sector the download only partly covers hold other data: a marker in the
+       whole program units outside [addr, end), which erase on demand must not touch */
+    addr = app_base + off;
+    end = addr + img_len;
+    lo = addr & ~(model->erase_unit - 1);
+    hi = (end + model->erase_unit - 1) & ~(model->erase_unit - 1);
+    ua = addr & ~(model->program_unit - 1);
+    ue = (end + model->program_unit - 1) & ~(model->program_unit - 1);
+    memset(nor.mem + lo, 0x5A, ua - lo);
+    memset(nor.mem + ue, 0x5A, hi - ue);
+
+    /* the engine, configured like a board does from FLASH_GetGeometry */
+    mflash.cfg_start = app_base;
+    mflash.cfg_size = model->flash_size - app_base;
+    mflash.cfg_erase_unit = model->erase_unit;
+    mflash.cfg_program_unit = model->program_unit;
+    mflash.cfg_erase_time_us = model->erase_us;
+    mflash.cfg_program_time_us = model->program_us;
+    mflash.cfg_block_size = model->block_size;
+    mflash.op_erase = flash_erase;
+    mflash.op_program = flash_program;
+    mflash.op_read = flash_read;
+    mflash.op_erase_block = (model->block_size)?(flash_erase_block):(NULL);
+    mflash_init(&mflash);
+
+    burst.cfg_start = mflash.cfg_start;
+    burst.cfg_size = mflash.cfg_size;
+    burst.cfg_buf_size = burst_kb * 1024;
+    burst.cfg_buf = malloc(burst.cfg_buf_size + 4);
+    burst.cfg_erase_unit = model->erase_unit;
+    burst.cfg_program_unit = model->program_unit;
+    burst.op_program = flash_program;
+    burst.op_read = flash_read;
+
+    mcuboot.op_send = mcuboot_send;
+    mcuboot.op_reset = mcuboot_reset;
+    mcuboot.op_jump = mcuboot_jump;
+    mcuboot.op_complete = mcuboot_complete;
+    mcuboot.op_mem_erase = (raw)?(raw_erase):(memory_erase);
+    mcuboot.op_mem_write = (raw)?(raw_write):(memory_write);
+    mcuboot.op_mem_read = memory_read;
+    mcuboot.op_mem_flush = (raw)?(NULL):(memory_flush);
+    if(burst_kb && !raw)
+    {
+        mcuboot.op_mem_write = burst_write;
+        mcuboot.op_mem_flush = burst_flush;
+        mcuboot.op_mem_begin = burst_begin;
+    }
+    mcuboot.cfg_flash_start = app_base;
+    mcuboot.cfg_flash_size = model->flash_size - app_base;
+    mcuboot.cfg_flash_sector_size = model->erase_unit;
+    mcuboot.cfg_ack_before_write = ack_first;
+    mcuboot_init(&mcuboot);
+
+    /* the blhost download sequence */
+    host_ping();
+    if(no_erase)
+    {
+#if (MCUBOOT_ERASE_ON_DEMAND == 1)
+        status = 0;
+#else
+        printf("-E needs a build with -DMCUBOOT_ERASE_ON_DEMAND=1\r\n");
+        return 1;
+#endif
+    }
+    else if(erase_all)
+    {
+        status = host_cmd(kCommandTag_FlashEraseAll, 1, 0, 0);
+    }
+    else
+    {
+        status = host_cmd(kCommandTag_FlashEraseRegion, 2, addr, img_len);
+    }
+    if(status)
+    {
+        printf("erase failed: 0x%X\r\n", status);
+        ret = 1;
+    }
+
+    status = host_cmd(kCommandTag_WriteMemory, 2, addr, img_len);
+    host.resp_cnt = 0;
+    for(pos = 0; pos < img_len; pos += n)
+    {
+        n = ((img_len - pos) > MAX_PACKET_LEN)?(MAX_PACKET_LEN):(img_len - pos);
+        kptl_frame_packet_begin(&fp, kFramingPacketType_Data);
+        kptl_frame_packet_add(&fp, img + pos, n);
+        kptl_frame_packet_final(&fp);
+        host_send((uint8_t*)&fp, kptl_frame_packet_get_size(&fp), ack_first);
+    }
+    if(host.resp_cnt == 0 || host.resp_status)
+    {
+        printf("write memory not completed\r\n");
+        ret = 1;
+    }
+
+    printf("family %s, strategy %s%s%s, image %d bytes at 0x%X, packet %d bytes, %d baud, read chunk %d\r\n", model->name,
+            (raw)?("raw"):((burst_kb)?("burst"):("mflash")), (ack_first)?(" ack-first"):(""), (no_erase)?(" erase-on-demand"):(""), img_len, addr, MAX_PACKET_LEN, baud, rx_chunk);
+    printf("erase:      %d units, %d blocks\r\n", nor.erase_cnt, nor.block_erase_cnt);
+    printf("program:    %d commands\r\n", nor.program_cmd_cnt);
+    printf("violations: range %d, align %d, not erased %d\r\n", nor.err_range, nor.err_align, nor.err_not_erased);
+    printf("time:       flash %.1fms, link %.1fms, total %.1fms, %.2fKB/s\r\n", nor.busy_us/1000.0,
+            link_bytes * 10 * 1000.0 / baud, total_us/1000.0, img_len / 1024.0 / (total_us / 1000000.0));
+
+    /* an erase command covers whole sectors, the marker only has to survive erase on demand */
+    if(no_erase)
+    {
+        for(pos = lo; pos < hi; pos++)
+        {
+            if(((pos < ua) || (pos >= ue)) && (nor.mem[pos] != 0x5A))
+            {
+                kept = 0;
+            }
+        }
+        printf("neighbours: %s, %d bytes before and %d after the download\r\n", (kept)?("kept"):("CHANGED"), ua - lo, hi - ue);
+    }
+    if(memcmp(nor.mem + addr, img, img_len) || !kept)
+    {
+        printf("verify:     FAILED\r\n");
+        ret = 1;
+    }
+    else
+    {
+        printf("verify:     OK\r\n");
+    }
+    if(nor.err_range || nor.err_align || nor.err_not_erased)
+    {
+        ret = 1;
+    }
+
+    free(burst.cfg_buf);
+    free(img);
+    nor_sim_deinit(&nor);
+    return ret;
+}
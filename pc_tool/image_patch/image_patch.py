@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+#
+# Copyright 2018-2020 NXP
+# All rights reserved.
+#
+# SPDX-License-Identifier: BSD-3-Clause
+#
+# Fill the bl_image header (length, CRC32, version) into an application binary.
+# The header lives in the reserved vector table words at 0x20..0x2B, see
+# Libraries/utilities/bl_image/bl_image.h
+# With --loader, fill the size and CRC32 of a bl_loader header at offset 0
+# instead, see Libraries/utilities/bl_loader/bl_loader.h
+#
+# usage: image_patch.py app.bin [-v version] [--loader] [-o out.bin]
+
+import argparse
+import struct
+import sys
+import zlib
+
+HDR_OFFSET = 0x20
+LOADER_MAGIC = 0x444C4C42
+LOADER_HDR_SIZE = 20
+
+
+def patch(img, version):
+    img = bytearray(img)
+    # keep the length a multiple of 4, the padding is erased flash
+    while len(img) % 4:
+        img.append(0xFF)
+    if len(img) < HDR_OFFSET + 12:
+        raise ValueError("image too small for a vector table")
+
+    # the crc word is counted as 0
+    struct.pack_into("<III", img, HDR_OFFSET, len(img), 0, version)
+    crc = zlib.crc32(bytes(img)) & 0xFFFFFFFF
+    struct.pack_into("<I", img, HDR_OFFSET + 4, crc)
+    return img, crc
+
+
+def patch_loader(img):
+    img = bytearray(img)
+    while len(img) % 4:
+        img.append(0x00)
+    if len(img) < LOADER_HDR_SIZE or struct.unpack_from("<I", img, 0)[0] != LOADER_MAGIC:
+        raise ValueError("no bl_loader header at offset 0")
+
+    # magic, abi and entry come from the loader build
+    crc = zlib.crc32(bytes(img[LOADER_HDR_SIZE:])) & 0xFFFFFFFF
+    struct.pack_into("<II", img, 12, len(img), crc)
+    return img, crc
+
+
+def main():
+    parser = argparse.ArgumentParser(description="fill the bl_image header of an application binary")
+    parser.add_argument("bin", help="application binary, linked at APPLICATION_BASE")
+    parser.add_argument("-v", "--version", type=lambda s: int(s, 0), default=0, help="image version, 32 bit")
+    parser.add_argument("--loader", action="store_true", help="flash loader blob for Call, linked at its RAM address")
+    parser.add_argument("-o", "--output", help="output file, default: patch in place")
+    args = parser.parse_args()
+
+    with open(args.bin, "rb") as f:
+        img = f.read()
+
+    try:
+        if args.loader:
+            img, crc = patch_loader(img)
+        else:
+            img, crc = patch(img, args.version & 0xFFFFFFFF)
+    except ValueError as e:
+        print("error: %s" % e)
+        return 1
+
+    with open(args.output or args.bin, "wb") as f:
+        f.write(img)
+
+    if args.loader:
+        print("len: %d crc: 0x%08X" % (len(img), crc))
+    else:
+        print("len: %d crc: 0x%08X version: 0x%08X" % (len(img), crc, args.version & 0xFFFFFFFF))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())